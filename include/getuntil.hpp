@@ -8,7 +8,56 @@
 //
 #include <iostream>
 #include <string>
+#include <climits>
 
+namespace getuntil_detail {
+
+//! access to get area of streambuf
+/*!
+  @note gptr, egptr and gbump are protected. member pointers taken through
+    derived class are applied to streambuf object. (no cast of object)
+*/
+template<typename CharT, typename CharTraits>
+struct get_area : public std::basic_streambuf<CharT, CharTraits> {
+  typedef std::basic_streambuf<CharT, CharTraits> streambuf_type;
+
+  //! current position of get area
+  static CharT* next( streambuf_type* sb ) {
+    return ( sb->*( &get_area::gptr ) )();
+  }
+  //! end of get area
+  static CharT* end( streambuf_type* sb ) {
+    return ( sb->*( &get_area::egptr ) )();
+  }
+  //! advance current position of get area
+  static void bump( streambuf_type* sb, size_t n ) {
+    for( ; INT_MAX < n; n -= INT_MAX )  ( sb->*( &get_area::gbump ) )( INT_MAX );
+    ( sb->*( &get_area::gbump ) )( static_cast<int>( n ) );
+  }
+};
+
+//! inspect str ends with delm
+template<typename CharT, typename CharTraits, typename Allocator>
+bool ends_with(
+  const std::basic_string<CharT, CharTraits, Allocator>& str,
+  const std::basic_string<CharT, CharTraits, Allocator>& delm
+) {
+  return delm.size() <= str.size()
+    && CharTraits::compare( str.data() + str.size() - delm.size(), delm.data(), delm.size() ) == 0;
+}
+
+}  // namespace getuntil_detail
+
+//! read characters until delimiter. (delimiter is included in str)
+/*!
+  @note get area of streambuf is scanned for last character of delimiter
+    (CharTraits::find, memchr for char), and each hit is checked by compare
+    of tail of str. delimiter over edge of get area is found too, because
+    characters are appended to str before check.
+  @note unbuffered streambuf (no get area) is read character by character.
+  @note eofbit is set if input ends before delimiter, and failbit is set if
+    no character is read or str reaches max_size.
+*/
 template<typename CharT, typename CharTraits, typename Allocator>
 std::basic_istream<CharT, CharTraits>& getuntil(
   std::basic_istream<CharT, CharTraits>&  istrm,
@@ -16,48 +65,57 @@ std::basic_istream<CharT, CharTraits>& getuntil(
   const std::basic_string<CharT, CharTraits, Allocator>& delm
 ) {
   typedef std::basic_istream<CharT, CharTraits> istrm_type;
+  typedef getuntil_detail::get_area<CharT, CharTraits> get_area;
   std::ios_base::iostate cur_state  =  std::ios_base::goodbit;
   bool read_once = false;
   const typename istrm_type::sentry sync( istrm, true );
   if( sync ) {
     try {
       str.clear();
-      typename CharTraits::int_type row_xor  =  0;
-      typename CharTraits::int_type ins_xor  =  0;
-      size_t delm_len  =  delm.size();
-      typename CharTraits::int_type val = istrm.rdbuf()->sgetc();
-      for( size_t i = 0; i < delm_len - 1; ++i, val = istrm.rdbuf()->snextc() ) {
-          if( CharTraits::eq_int_type( CharTraits::eof(), val ) )  break;
-          read_once  =  true;
-          ins_xor   ^=  val;
-          row_xor   ^=  CharTraits::to_int_type( delm[ i ] );
-          str       +=  CharTraits::to_char_type( val );
-      }
-      row_xor  ^=  CharTraits::to_int_type( *delm.rbegin() );
-      for( size_t ipos = 0; ; val = istrm.rdbuf()->snextc(), ++ipos ) {
-        if( CharTraits::eq_int_type( CharTraits::eof(), val ) ) {
-          cur_state  |=  std::ios_base::eofbit;
-          break;
-        }
-        read_once =  true;
-        ins_xor  ^=  val;
-        str      +=  CharTraits::to_char_type( val );
-        if( 
-          ins_xor == row_xor 
-          && val == CharTraits::to_int_type( *delm.rbegin() ) 
-          && str.substr( ipos ) == delm 
-        ) {
-          istrm.rdbuf()->sbumpc();
-          break;
+      typename get_area::streambuf_type* sb  =  istrm.rdbuf();
+      const CharT last  =  *delm.rbegin();
+      for( ;; ) {
+        CharT* next  =  get_area::next( sb );
+        CharT* end   =  get_area::end( sb );
+        if( next == end ) {
+          // edge of get area. refill it.
+          typename CharTraits::int_type val  =  sb->sgetc();
+          if( CharTraits::eq_int_type( CharTraits::eof(), val ) ) {
+            cur_state  |=  std::ios_base::eofbit;
+            break;
+          }
+          next  =  get_area::next( sb );
+          end   =  get_area::end( sb );
+          if( next == end ) {
+            // unbuffered. one character.
+            if( str.max_size() <= str.size() ) {
+              cur_state  |=  std::ios_base::failbit;
+              break;
+            }
+            read_once  =  true;
+            str       +=  CharTraits::to_char_type( val );
+            sb->sbumpc();
+            if( CharTraits::eq( CharTraits::to_char_type( val ), last ) && getuntil_detail::ends_with( str, delm ) )  break;
+            continue;
+          }
         }
-        if( str.max_size() <= str.size() ) {
+        const CharT* hit  =  CharTraits::find( next, static_cast<size_t>( end - next ), last );
+        size_t len  =  hit ? static_cast<size_t>( hit - next ) + 1 : static_cast<size_t>( end - next );
+        if( str.max_size() - str.size() < len ) {
           cur_state  |=  std::ios_base::failbit;
           break;
         }
-        ins_xor  ^=  CharTraits::to_int_type( str[ipos] );
+        read_once  =  true;
+        str.append( next, len );
+        get_area::bump( sb, len );
+        if( hit && getuntil_detail::ends_with( str, delm ) )  break;
       }
     } catch(...) {
+#if defined(_MSC_VER)
       istrm.setstate( std::ios_base::badbit, true ); 
+#else
+      istrm.setstate( std::ios_base::badbit );
+#endif
     }
   }
   if( !read_once ) {
@@ -0,0 +1,62 @@
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+# pragma once
+#endif // defined(_MSC_VER) && (_MSC_VER >= 1200)
+#ifndef POP3BUFFER_HPP
+#define POP3BUFFER_HPP
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+//
+// Copyright (c) 2006-2009 OKI Miyuki (oki.miyuki at gmail dot com)
+//
+#include <vector>
+#include <limits>
+#include <boost/asio.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace rfc {
+namespace pop3 {
+
+//! pool of streambufs shared by sessions
+/*!
+  @note session takes buffer only while read or write is in flight, and
+    returns it after completion. so idle session holds no buffer, and the
+    number of buffers follows active sessions, not connections.
+  @note released buffer is emptied and kept for next acquire, up to
+    max_pooled buffers. buffers over it are deleted.
+  @note streambuf keeps its storage after consume. so buffer grown over
+    max_capacity (e.g. by large listing response) is deleted at release,
+    not pooled. pool holds at most max_pooled * max_capacity octets.
+*/
+class buffer_pool : private boost::noncopyable {
+public:
+  typedef boost::asio::streambuf  buffer_type;
+
+  //! constructor
+  explicit buffer_pool( std::size_t = (std::numeric_limits<std::size_t>::max)(), std::size_t = 1024, std::size_t = 4096 );
+  //! destructor. delete pooled buffers.
+  ~buffer_pool();
+
+  //! take empty buffer
+  buffer_type* acquire();
+  //! return buffer. (null is ignored)
+  void release( buffer_type* );
+  //! number of pooled buffers
+  std::size_t pooled() const;
+
+private:
+  mutable boost::mutex        mutex_;
+  std::vector<buffer_type*>   free_;
+  std::size_t                 max_size_;      //!< max size of each buffer
+  std::size_t                 max_pooled_;    //!< max number of pooled buffers
+  std::size_t                 max_capacity_;  //!< max capacity of pooled buffer
+};
+
+#include <pop3buffer.ipp>
+
+}  // namespace pop3
+}  // namespace rfc
+
+#endif  // POP3BUFFER_HPP
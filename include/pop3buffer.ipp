@@ -0,0 +1,73 @@
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+//
+// Copyright (c) 2006-2009 OKI Miyuki (oki.miyuki at gmail dot com)
+//
+
+//namespace rfc {
+//namespace pop3 {
+
+//! constructor
+inline buffer_pool::buffer_pool(
+  std::size_t max_size,   //!< [in] max size of each buffer (e.g. max command line)
+  std::size_t max_pooled, //!< [in] max number of pooled buffers
+  std::size_t max_capacity  //!< [in] max capacity of pooled buffer
+) :
+  mutex_(),
+  free_(),
+  max_size_( max_size ),
+  max_pooled_( max_pooled ),
+  max_capacity_( max_capacity )
+{
+}
+
+//! destructor. delete pooled buffers.
+inline buffer_pool::~buffer_pool() {
+  for( std::size_t i = 0; i < free_.size(); ++i )  delete free_[i];
+}
+
+//! take empty buffer
+/*!
+  @retval pooled buffer, or new buffer if pool is empty.
+*/
+inline buffer_pool::buffer_type* buffer_pool::acquire() {
+  {
+    boost::mutex::scoped_lock  lock( mutex_ );
+    if( !free_.empty() ) {
+      buffer_type*  buffer  =  free_.back();
+      free_.pop_back();
+      return buffer;
+    }
+  }
+  return new buffer_type( max_size_ );
+}
+
+//! return buffer. (null is ignored)
+/*!
+  @note buffer over max capacity is deleted. so its storage is freed.
+*/
+inline void buffer_pool::release(
+  buffer_type*  buffer  //!< [in] buffer taken by acquire
+) {
+  if( !buffer )  return;
+  buffer->consume( buffer->size() );
+  if( buffer->capacity() <= max_capacity_ ) {
+    boost::mutex::scoped_lock  lock( mutex_ );
+    if( free_.size() < max_pooled_ ) {
+      free_.push_back( buffer );
+      return;
+    }
+  }
+  delete buffer;
+}
+
+//! number of pooled buffers
+inline std::size_t buffer_pool::pooled() const {
+  boost::mutex::scoped_lock  lock( mutex_ );
+  return free_.size();
+}
+
+//}  // namespace pop3
+//}  // namespace rfc
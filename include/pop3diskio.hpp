@@ -0,0 +1,142 @@
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+# pragma once
+#endif // defined(_MSC_VER) && (_MSC_VER >= 1200)
+#ifndef POP3DISKIO_HPP
+#define POP3DISKIO_HPP
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+//
+// Copyright (c) 2006-2009 OKI Miyuki (oki.miyuki at gmail dot com)
+//
+#include <string>
+#include <vector>
+#include <fstream>
+#include <boost/asio.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/noncopyable.hpp>
+
+namespace rfc {
+namespace pop3 {
+
+//! file read operation. run on worker thread of disk_io_executor.
+template <typename Handler>
+struct disk_read_op {
+  boost::asio::io_service&          loop_;
+  boost::shared_ptr<std::ifstream>  stream_;
+  std::string                       path_;
+  unsigned long                     offset_;
+  std::size_t                       length_;
+  Handler                           handler_;
+
+  disk_read_op( boost::asio::io_service&, boost::shared_ptr<std::ifstream>, const std::string&, unsigned long, std::size_t, Handler );
+  void operator()();
+};
+
+//! file stat operation. run on worker thread of disk_io_executor.
+template <typename Handler>
+struct disk_stat_op {
+  boost::asio::io_service&  loop_;
+  std::string               path_;
+  Handler                   handler_;
+
+  disk_stat_op( boost::asio::io_service&, const std::string&, Handler );
+  void operator()();
+};
+
+//! blocking call. run on worker thread of disk_io_executor.
+template <typename Function, typename Handler>
+struct disk_call_op {
+  boost::asio::io_service&  loop_;
+  Function                  function_;
+  Handler                   handler_;
+
+  disk_call_op( boost::asio::io_service&, Function, Handler );
+  void operator()();
+};
+
+//! disk I/O executor
+/*!
+  @note Blocking file reads and stats run on a bounded thread pool, and
+    completion handlers are posted back to the io_service of the caller
+    (= session loop). So cold disk reads never stall the network loop.
+*/
+class disk_io_executor : private boost::noncopyable {
+public:
+  typedef boost::shared_ptr< std::vector<char> >  buffer_ptr;
+
+  //! constructor. start worker threads.
+  explicit disk_io_executor( std::size_t threads = 4 );
+  //! destructor. stop worker threads.
+  ~disk_io_executor();
+
+  //! read file range. handler( const boost::system::error_code&, buffer_ptr )
+  template <typename Handler>
+  void async_read( boost::asio::io_service&, const std::string&, unsigned long, std::size_t, Handler );
+  //! read file range from kept stream. handler( const boost::system::error_code&, buffer_ptr )
+  template <typename Handler>
+  void async_read( boost::asio::io_service&, boost::shared_ptr<std::ifstream>, const std::string&, unsigned long, std::size_t, Handler );
+  //! get file size. handler( const boost::system::error_code&, unsigned long )
+  template <typename Handler>
+  void async_stat( boost::asio::io_service&, const std::string&, Handler );
+  //! run blocking function. handler( result of function )
+  template <typename Function, typename Handler>
+  void async_call( boost::asio::io_service&, Function, Handler );
+  //! stop worker threads. pending requests are discarded.
+  void stop();
+
+private:
+  boost::asio::io_service                          service_;
+  boost::scoped_ptr<boost::asio::io_service::work>  work_;
+  boost::thread_group                              threads_;
+};
+
+//! state of one file response (RETR, TOP) in progress
+/*!
+  @note At most one read and one write are in flight. Next chunk is read
+    while previous chunk is written, so disk reads and network writes overlap.
+    File is opened by first read, and kept open until end of transfer.
+    +OK line is written with first chunk, after file is opened.
+*/
+struct file_transfer {
+  disk_io_executor&               executor_;
+  boost::shared_ptr<std::ifstream>  stream_;  //!< message file (used by one read at a time)
+  std::string                     path_;
+  unsigned long                   offset_;    //!< next read position
+  unsigned long                   remain_;    //!< bytes not yet read
+  std::size_t                     chunk_;     //!< read-ahead size
+  bool                            reading_;   //!< read is in flight
+  bool                            writing_;   //!< write is in flight
+  bool                            line_head_; //!< next byte is head of line
+  char                            last_;      //!< last byte of message
+  std::size_t                     outstanding_; //!< bytes read and not yet written
+  unsigned long                   position_;  //!< file position of next byte to stuff
+  unsigned long                   body_;      //!< file position of body (for line limit)
+  unsigned long                   lines_;     //!< body lines left to send
+  bool                            limited_;   //!< body lines are limited (TOP)
+  boost::shared_ptr<std::string>  pending_;   //!< chunk waiting for write
+  boost::shared_ptr<std::string>  head_;      //!< +OK line. written with first chunk
+
+  //! constructor
+  file_transfer( disk_io_executor&, const std::string&, unsigned long, unsigned long, std::size_t );
+
+  //! limit body lines. (TOP)
+  void limit_lines( unsigned long, unsigned long );
+  //! append dot-stuffed chunk to output
+  void stuff( const std::vector<char>&, std::string& );
+  //! append termination octet to output
+  void terminate( std::string& );
+  //! inspect all chunks are read and written
+  bool done() const;
+};
+
+#include <pop3diskio.ipp>
+
+}  // namespace pop3
+}  // namespace rfc
+
+#endif  // POP3DISKIO_HPP
@@ -0,0 +1,275 @@
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+//
+// Copyright (c) 2006-2009 OKI Miyuki (oki.miyuki at gmail dot com)
+//
+
+//namespace rfc {
+//namespace pop3 {
+
+//! constructor. start worker threads.
+inline disk_io_executor::disk_io_executor(
+  std::size_t threads  //!< [in] number of worker threads
+) :
+  service_(),
+  work_( new boost::asio::io_service::work( service_ ) ),
+  threads_()
+{
+  if( threads == 0 )  threads  =  1;
+  for( std::size_t i = 0; i < threads; ++i ) {
+    threads_.create_thread( boost::bind( &boost::asio::io_service::run, &service_ ) );
+  }
+}
+
+//! destructor. stop worker threads.
+inline disk_io_executor::~disk_io_executor() {
+  stop();
+}
+
+//! stop worker threads. pending requests are discarded.
+inline void disk_io_executor::stop() {
+  work_.reset();
+  service_.stop();
+  threads_.join_all();
+}
+
+//! read file range.
+/*!
+  @note handler is called on loop, with read data. data may be shorter than
+    requested length at end of file.
+*/
+template <typename Handler>
+void disk_io_executor::async_read(
+  boost::asio::io_service&  loop,     //!< [in] io_service to post completion
+  const std::string&        path,     //!< [in] file path
+  unsigned long             offset,   //!< [in] start position
+  std::size_t               length,   //!< [in] bytes to read
+  Handler                   handler   //!< [in] completion handler
+) {
+  async_read( loop, boost::shared_ptr<std::ifstream>( new std::ifstream() ), path, offset, length, handler );
+}
+
+//! read file range from kept stream.
+/*!
+  @note stream is opened by first read, and sequential reads skip seek. so
+    chunked reads of one file open it once.
+  @attention caller must not start next read of same stream until handler
+    is called.
+*/
+template <typename Handler>
+void disk_io_executor::async_read(
+  boost::asio::io_service&          loop,     //!< [in] io_service to post completion
+  boost::shared_ptr<std::ifstream>  stream,   //!< [in] kept stream (opened at first read)
+  const std::string&                path,     //!< [in] file path
+  unsigned long                     offset,   //!< [in] start position
+  std::size_t                       length,   //!< [in] bytes to read
+  Handler                           handler   //!< [in] completion handler
+) {
+  service_.post(
+    disk_read_op<Handler>( loop, stream, path, offset, length, handler )
+  );
+}
+
+//! get file size.
+/*!
+  @note handler is called on loop.
+*/
+template <typename Handler>
+void disk_io_executor::async_stat(
+  boost::asio::io_service&  loop,     //!< [in] io_service to post completion
+  const std::string&        path,     //!< [in] file path
+  Handler                   handler   //!< [in] completion handler
+) {
+  service_.post(
+    disk_stat_op<Handler>( loop, path, handler )
+  );
+}
+
+//! run blocking function.
+/*!
+  @note for blocking file operation other than read. (e.g. rewrite of mbox)
+    handler is called on loop, with result of function.
+*/
+template <typename Function, typename Handler>
+void disk_io_executor::async_call(
+  boost::asio::io_service&  loop,     //!< [in] io_service to post completion
+  Function                  function, //!< [in] blocking function
+  Handler                   handler   //!< [in] completion handler
+) {
+  service_.post(
+    disk_call_op<Function, Handler>( loop, function, handler )
+  );
+}
+
+//! constructor
+template <typename Handler>
+disk_read_op<Handler>::disk_read_op(
+  boost::asio::io_service&          loop,
+  boost::shared_ptr<std::ifstream>  stream,
+  const std::string&                path,
+  unsigned long                     offset,
+  std::size_t                       length,
+  Handler                           handler
+) :
+  loop_( loop ),
+  stream_( stream ),
+  path_( path ),
+  offset_( offset ),
+  length_( length ),
+  handler_( handler )
+{
+}
+
+//! do read on worker thread. and post completion to loop.
+template <typename Handler>
+void disk_read_op<Handler>::operator()() {
+  boost::system::error_code  error;
+  disk_io_executor::buffer_ptr  data( new std::vector<char>( length_ ) );
+  std::ifstream&  ifs  =  *stream_;
+  if( !ifs.is_open() )  ifs.open( path_.c_str(), std::ios::binary );
+  if( !ifs ) {
+    error  =  boost::system::errc::make_error_code( boost::system::errc::no_such_file_or_directory );
+    data->clear();
+  } else {
+    if( ifs.tellg() != static_cast<std::streampos>( offset_ ) )  ifs.seekg( static_cast<std::streamoff>( offset_ ) );
+    if( length_ )  ifs.read( &(*data)[0], static_cast<std::streamsize>( length_ ) );
+    data->resize( static_cast<std::size_t>( ifs.gcount() ) );
+    if( data->empty() && length_ )  error  =  boost::asio::error::eof;
+    ifs.clear();
+  }
+  loop_.post( boost::bind<void>( handler_, error, data ) );
+}
+
+//! constructor
+template <typename Handler>
+disk_stat_op<Handler>::disk_stat_op(
+  boost::asio::io_service&  loop,
+  const std::string&        path,
+  Handler                   handler
+) :
+  loop_( loop ),
+  path_( path ),
+  handler_( handler )
+{
+}
+
+//! do stat on worker thread. and post completion to loop.
+template <typename Handler>
+void disk_stat_op<Handler>::operator()() {
+  boost::system::error_code  error;
+  unsigned long  size  =  0;
+  std::ifstream  ifs( path_.c_str(), std::ios::binary );
+  if( !ifs ) {
+    error  =  boost::system::errc::make_error_code( boost::system::errc::no_such_file_or_directory );
+  } else {
+    ifs.seekg( 0, std::ios::end );
+    size  =  static_cast<unsigned long>( ifs.tellg() );
+  }
+  loop_.post( boost::bind<void>( handler_, error, size ) );
+}
+
+//! constructor
+template <typename Function, typename Handler>
+disk_call_op<Function, Handler>::disk_call_op(
+  boost::asio::io_service&  loop,
+  Function                  function,
+  Handler                   handler
+) :
+  loop_( loop ),
+  function_( function ),
+  handler_( handler )
+{
+}
+
+//! do call on worker thread. and post completion to loop.
+template <typename Function, typename Handler>
+void disk_call_op<Function, Handler>::operator()() {
+  loop_.post( boost::bind<void>( handler_, function_() ) );
+}
+
+//! constructor
+inline file_transfer::file_transfer(
+  disk_io_executor&   executor, //!< [in] executor for disk reads
+  const std::string&  path,     //!< [in] message file path
+  unsigned long       offset,   //!< [in] start position of message
+  unsigned long       length,   //!< [in] length of message
+  std::size_t         chunk     //!< [in] read-ahead size
+) :
+  executor_( executor ),
+  stream_( new std::ifstream() ),
+  path_( path ),
+  offset_( offset ),
+  remain_( length ),
+  chunk_( chunk ),
+  reading_( false ),
+  writing_( false ),
+  line_head_( true ),
+  last_( '\n' ),
+  outstanding_( 0 ),
+  position_( offset ),
+  body_( 0 ),
+  lines_( 0 ),
+  limited_( false ),
+  pending_(),
+  head_()
+{
+}
+
+//! limit body lines. (TOP)
+/*!
+  @note used when end of TOP range is not known from index. reading stops
+    at head of first body line over the limit.
+*/
+inline void file_transfer::limit_lines(
+  unsigned long body,   //!< [in] file position of body
+  unsigned long lines   //!< [in] number of body lines
+) {
+  body_     =  body;
+  lines_    =  lines;
+  limited_  =  true;
+}
+
+//! append dot-stuffed chunk to output
+/*!
+  @note RFC 1939: line which begins with termination octet is byte-stuffed.
+    bare LF is sent as CRLF. (its CR is counted in size of index_message)
+    state of line head and last byte is kept across chunks.
+*/
+inline void file_transfer::stuff(
+  const std::vector<char>&  data,   //!< [in] raw chunk
+  std::string&              out     //!< [out,ref] stuffed chunk
+) {
+  out.reserve( out.size() + data.size() + data.size() / 64 + 8 );
+  for( std::vector<char>::const_iterator it = data.begin(); it != data.end(); ++it, ++position_ ) {
+    if( limited_ && line_head_ && body_ <= position_ ) {
+      if( lines_ == 0 ) {
+        remain_  =  0;
+        break;
+      }
+      --lines_;
+    }
+    if( line_head_ && *it == '.' )  out  +=  '.';
+    if( *it == '\n' && last_ != '\r' )  out  +=  '\r';
+    out        +=  *it;
+    line_head_  =  ( *it == '\n' );
+    last_       =  *it;
+  }
+}
+
+//! append termination octet to output
+inline void file_transfer::terminate(
+  std::string& out  //!< [out,ref] last chunk
+) {
+  if( last_ != '\n' )  out  +=  "\r\n";
+  out  +=  ".\r\n";
+}
+
+//! inspect all chunks are read and written
+inline bool file_transfer::done() const {
+  return remain_ == 0 && !reading_ && !writing_ && !pending_;
+}
+
+//}  // namespace pop3
+//}  // namespace rfc
@@ -0,0 +1,152 @@
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+# pragma once
+#endif // defined(_MSC_VER) && (_MSC_VER >= 1200)
+#ifndef POP3LIMITER_HPP
+#define POP3LIMITER_HPP
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+//
+// Copyright (c) 2006-2009 OKI Miyuki (oki.miyuki at gmail dot com)
+//
+#include <string>
+#include <map>
+#include <algorithm>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/atomic.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <pop3parser.hpp>
+
+namespace rfc {
+namespace pop3 {
+
+//! rate of token bucket
+struct bucket_rate {
+  double  rate_;    //!< tokens refilled per second
+  double  burst_;   //!< bucket size (max tokens)
+
+  //! constructor
+  bucket_rate( double, double );
+};
+
+//! token bucket of one client (IP address or account)
+struct token_bucket {
+  double                    tokens_;  //!< available tokens. negative is debt of large response
+  boost::posix_time::ptime  last_;    //!< last refill time
+
+  //! constructor
+  token_bucket();
+};
+
+//! sharded table of token buckets
+/*!
+  @note key is hashed to one of shard_count shards, and each shard has its
+    own lock. so sessions of different clients rarely wait for each other.
+    Buckets refilled to full are dropped when shard grows over shard_limit.
+*/
+class bucket_table : private boost::noncopyable {
+public:
+  //! constructor
+  explicit bucket_table( const bucket_rate& );
+
+  //! take tokens from bucket of key
+  bool take( const std::string&, double );
+  //! take tokens without check. (bucket may go into debt)
+  void charge( const std::string&, double );
+  //! inspect bucket of key has tokens. (tokens are not taken)
+  bool available( const std::string&, double );
+  //! number of buckets
+  std::size_t size() const;
+
+private:
+  enum { shard_count = 16, shard_limit = 4096 };
+
+  struct shard {
+    mutable boost::mutex                   mutex_;
+    std::map<std::string, token_bucket>   buckets_;
+  };
+
+  //! shard of key
+  shard& shard_of( const std::string& );
+  //! refill bucket up to now
+  void refill( token_bucket&, const boost::posix_time::ptime& ) const;
+  //! drop full buckets of shard
+  void expire( shard&, const boost::posix_time::ptime& ) const;
+  //! find or create bucket of key, and refill it
+  token_bucket& bucket_of( shard&, const std::string&, const boost::posix_time::ptime& ) const;
+
+private:
+  bucket_rate  rate_;
+  shard        shards_[shard_count];
+};
+
+//! admission limits
+struct admission_limits {
+  long          max_connections_; //!< max concurrent connections (0: unlimited)
+  bucket_rate   ip_rate_;         //!< connections and commands before login, per IP address
+  bucket_rate   user_rate_;       //!< logins and commands in transaction, per account
+  double        connect_cost_;    //!< cost of one connection
+  double        login_cost_;      //!< cost of one PASS or APOP
+  double        command_cost_[pop3_cmd_quit + 1]; //!< cost of each command (index is pop3_command_type)
+  double        octet_cost_;      //!< cost of one octet of RETR and TOP response
+
+  //! constructor. set default limits.
+  admission_limits();
+};
+
+//! result of connection admission
+enum admission_result {
+  admission_accepted,   //!< connection is accepted
+  admission_busy,       //!< server has max connections
+  admission_throttled   //!< client IP address is over rate
+};
+
+//! admission control of pop3 server
+/*!
+  @note One instance is shared by server and its sessions. Connection count
+    is atomic, and token buckets are sharded (see bucket_table). Commands are
+    charged to IP address bucket before login, and to account bucket in
+    transaction. Response octets are charged after the response is decided,
+    so a large RETR puts the bucket into debt and delays next commands.
+    Login is charged after password check. successful login is charged to
+    account, and failed login to IP address. so others can not lock account
+    out by wrong passwords. empty IP address (stream without client address,
+    e.g. Unix domain socket) is not limited per IP address.
+*/
+class admission_control : private boost::noncopyable {
+public:
+  //! constructor
+  explicit admission_control( const admission_limits& = admission_limits() );
+
+  //! admit new connection of IP address
+  admission_result admit_connection( const std::string& );
+  //! release admitted connection
+  void release_connection();
+  //! admit login of account
+  bool admit_user( const std::string& );
+  //! charge login to account (success) or IP address (failure)
+  void charge_login( const std::string&, const std::string&, bool );
+  //! admit command of IP address or account
+  bool admit_command( const std::string&, const std::string&, pop3_command_type );
+  //! charge octets of response to IP address or account
+  void charge_octets( const std::string&, const std::string&, unsigned long );
+  //! number of admitted connections
+  long connections() const;
+  //! admission limits
+  const admission_limits& limits() const;
+
+private:
+  admission_limits            limits_;
+  boost::atomic<long>         connections_;
+  bucket_table                ips_;
+  bucket_table                users_;
+};
+
+#include <pop3limiter.ipp>
+
+}  // namespace pop3
+}  // namespace rfc
+
+#endif  // POP3LIMITER_HPP
@@ -0,0 +1,279 @@
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+//
+// Copyright (c) 2006-2009 OKI Miyuki (oki.miyuki at gmail dot com)
+//
+
+//namespace rfc {
+//namespace pop3 {
+
+//! constructor
+inline bucket_rate::bucket_rate(
+  double rate,  //!< [in] tokens refilled per second
+  double burst  //!< [in] bucket size
+) :
+  rate_( rate ),
+  burst_( burst )
+{
+}
+
+//! constructor
+inline token_bucket::token_bucket() :
+  tokens_( 0 ),
+  last_()
+{
+}
+
+//! constructor
+inline bucket_table::bucket_table(
+  const bucket_rate& rate //!< [in] rate of all buckets
+) :
+  rate_( rate )
+{
+}
+
+//! take tokens from bucket of key
+/*!
+  @note cost larger than burst is accepted with full bucket, and leaves debt.
+  @retval true tokens are taken
+  @retval false bucket has not enough tokens
+*/
+inline bool bucket_table::take(
+  const std::string&  key,  //!< [in] IP address or account
+  double              cost  //!< [in] tokens to take
+) {
+  if( cost <= 0 )  return true;
+  boost::posix_time::ptime  now  =  boost::posix_time::microsec_clock::universal_time();
+  shard&  s  =  shard_of( key );
+  boost::mutex::scoped_lock  lock( s.mutex_ );
+  token_bucket&  b  =  bucket_of( s, key, now );
+  if( b.tokens_ < std::min( cost, rate_.burst_ ) )  return false;
+  b.tokens_  -=  cost;
+  return true;
+}
+
+//! take tokens without check. (bucket may go into debt)
+inline void bucket_table::charge(
+  const std::string&  key,  //!< [in] IP address or account
+  double              cost  //!< [in] tokens to take
+) {
+  if( cost <= 0 )  return;
+  boost::posix_time::ptime  now  =  boost::posix_time::microsec_clock::universal_time();
+  shard&  s  =  shard_of( key );
+  boost::mutex::scoped_lock  lock( s.mutex_ );
+  bucket_of( s, key, now ).tokens_  -=  cost;
+}
+
+//! inspect bucket of key has tokens. (tokens are not taken)
+/*!
+  @note unknown key is not added. (same as full bucket)
+  @retval true take() of cost will succeed now
+*/
+inline bool bucket_table::available(
+  const std::string&  key,  //!< [in] IP address or account
+  double              cost  //!< [in] tokens to inspect
+) {
+  if( cost <= 0 )  return true;
+  boost::posix_time::ptime  now  =  boost::posix_time::microsec_clock::universal_time();
+  shard&  s  =  shard_of( key );
+  boost::mutex::scoped_lock  lock( s.mutex_ );
+  std::map<std::string, token_bucket>::iterator  it  =  s.buckets_.find( key );
+  if( it == s.buckets_.end() )  return true;
+  refill( it->second, now );
+  return std::min( cost, rate_.burst_ ) <= it->second.tokens_;
+}
+
+//! number of buckets
+inline std::size_t bucket_table::size() const {
+  std::size_t  result  =  0;
+  for( std::size_t i = 0; i < shard_count; ++i ) {
+    boost::mutex::scoped_lock  lock( shards_[i].mutex_ );
+    result  +=  shards_[i].buckets_.size();
+  }
+  return result;
+}
+
+//! shard of key. (FNV-1a hash)
+inline bucket_table::shard& bucket_table::shard_of(
+  const std::string& key  //!< [in] IP address or account
+) {
+  unsigned long  hash  =  2166136261UL;
+  for( std::string::const_iterator it = key.begin(); it != key.end(); ++it ) {
+    hash  =  ( ( hash ^ static_cast<unsigned char>( *it ) ) * 16777619UL ) & 0xffffffffUL;
+  }
+  return shards_[ hash % shard_count ];
+}
+
+//! refill bucket up to now
+inline void bucket_table::refill(
+  token_bucket&                    b,   //!< [in,out] bucket
+  const boost::posix_time::ptime&  now  //!< [in] current time
+) const {
+  if( b.last_ < now ) {
+    double  sec  =  ( now - b.last_ ).total_microseconds() / 1000000.0;
+    b.tokens_  =  std::min( rate_.burst_, b.tokens_ + sec * rate_.rate_ );
+  }
+  b.last_  =  now;
+}
+
+//! drop full buckets of shard
+/*!
+  @note full bucket is same as new bucket. so dropping it changes nothing.
+*/
+inline void bucket_table::expire(
+  shard&                           s,   //!< [in,out] locked shard
+  const boost::posix_time::ptime&  now  //!< [in] current time
+) const {
+  std::map<std::string, token_bucket>::iterator  it  =  s.buckets_.begin();
+  while( it != s.buckets_.end() ) {
+    refill( it->second, now );
+    if( rate_.burst_ <= it->second.tokens_ )  s.buckets_.erase( it++ );
+    else                                      ++it;
+  }
+}
+
+//! find or create bucket of key, and refill it
+inline token_bucket& bucket_table::bucket_of(
+  shard&                           s,   //!< [in,out] locked shard
+  const std::string&               key, //!< [in] IP address or account
+  const boost::posix_time::ptime&  now  //!< [in] current time
+) const {
+  std::map<std::string, token_bucket>::iterator  it  =  s.buckets_.find( key );
+  if( it == s.buckets_.end() ) {
+    if( shard_limit <= s.buckets_.size() )  expire( s, now );
+    token_bucket  b;
+    b.tokens_  =  rate_.burst_;
+    b.last_    =  now;
+    it  =  s.buckets_.insert( std::make_pair( key, b ) ).first;
+  }
+  refill( it->second, now );
+  return it->second;
+}
+
+//! constructor. set default limits.
+/*!
+  @note defaults charge mostly per connection, login and octet. so one
+    normal session never hits them, and only repeated logins, password
+    guessing and bulk download are slowed down.
+    @li account: one token is one login, 100 commands in transaction, or
+      4MiB of RETR and TOP response. burst 120 admits a session which logs
+      in, and LISTs, UIDLs and TOPs 10000 messages (about 100 tokens).
+      refill 1/s is 4MiB/s of download, or one login per second.
+    @li IP address: one token is one connection or one failed login.
+      commands before login cost 0.1 (USER, PASS, APOP) or 0.5 (invalid
+      command). burst 60 admits about 50 connections at once (e.g. clients
+      behind NAT), and refill 1/s allows less than one password guess per
+      second.
+*/
+inline admission_limits::admission_limits() :
+  max_connections_( 10000 ),
+  ip_rate_( 1.0, 60.0 ),
+  user_rate_( 1.0, 120.0 ),
+  connect_cost_( 1.0 ),
+  login_cost_( 1.0 ),
+  octet_cost_( 1.0 / ( 4 * 1024 * 1024 ) )
+{
+  std::fill( command_cost_, command_cost_ + pop3_cmd_quit + 1, 0.01 );
+  command_cost_[ pop3_detect_error ]  =  0.5;
+  command_cost_[ pop3_cmd_user ]      =  0.1;
+  command_cost_[ pop3_cmd_pass ]      =  0.1;
+  command_cost_[ pop3_cmd_apop ]      =  0.1;
+  command_cost_[ pop3_cmd_quit ]      =  0;
+}
+
+//! constructor
+inline admission_control::admission_control(
+  const admission_limits& limits  //!< [in] admission limits
+) :
+  limits_( limits ),
+  connections_( 0 ),
+  ips_( limits.ip_rate_ ),
+  users_( limits.user_rate_ )
+{
+}
+
+//! admit new connection of IP address
+/*!
+  @note accepted connection must be released by release_connection().
+  @retval admission_accepted connection is counted
+  @retval admission_busy server has max connections
+  @retval admission_throttled IP address connects too often
+*/
+inline admission_result admission_control::admit_connection(
+  const std::string& ip //!< [in] client IP address
+) {
+  if( 0 < limits_.max_connections_ && limits_.max_connections_ < ++connections_ ) {
+    --connections_;
+    return admission_busy;
+  }
+  if( !ip.empty() && !ips_.take( ip, limits_.connect_cost_ ) ) {
+    --connections_;
+    return admission_throttled;
+  }
+  return admission_accepted;
+}
+
+//! release admitted connection
+inline void admission_control::release_connection() {
+  --connections_;
+}
+
+//! admit login of account
+/*!
+  @note account is not charged here. charge_login() after password check.
+*/
+inline bool admission_control::admit_user(
+  const std::string& user //!< [in] mail account (user) name
+) {
+  return users_.available( user, limits_.login_cost_ );
+}
+
+//! charge login to account (success) or IP address (failure)
+inline void admission_control::charge_login(
+  const std::string&  ip,       //!< [in] client IP address
+  const std::string&  user,     //!< [in] mail account (user) name
+  bool                success   //!< [in] password is accepted
+) {
+  if( success )           users_.charge( user, limits_.login_cost_ );
+  else if( !ip.empty() )  ips_.charge( ip, limits_.login_cost_ );
+}
+
+//! admit command of IP address or account
+/*!
+  @note empty user means out of transaction. command is charged to IP address.
+*/
+inline bool admission_control::admit_command(
+  const std::string&  ip,   //!< [in] client IP address
+  const std::string&  user, //!< [in] mail account in transaction, or empty
+  pop3_command_type   type  //!< [in] command type
+) {
+  double  cost  =  limits_.command_cost_[ type ];
+  if( user.empty() )  return ip.empty() || ips_.take( ip, cost );
+  return users_.take( user, cost );
+}
+
+//! charge octets of response to IP address or account
+inline void admission_control::charge_octets(
+  const std::string&  ip,     //!< [in] client IP address
+  const std::string&  user,   //!< [in] mail account in transaction, or empty
+  unsigned long       octets  //!< [in] response octets
+) {
+  double  cost  =  octets * limits_.octet_cost_;
+  if( !user.empty() )    users_.charge( user, cost );
+  else if( !ip.empty() )  ips_.charge( ip, cost );
+}
+
+//! number of admitted connections
+inline long admission_control::connections() const {
+  return connections_;
+}
+
+//! admission limits
+inline const admission_limits& admission_control::limits() const {
+  return limits_;
+}
+
+//}  // namespace pop3
+//}  // namespace rfc
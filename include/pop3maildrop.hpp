@@ -0,0 +1,176 @@
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+# pragma once
+#endif // defined(_MSC_VER) && (_MSC_VER >= 1200)
+#ifndef POP3MAILDROP_HPP
+#define POP3MAILDROP_HPP
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+//
+// Copyright (c) 2006-2009 OKI Miyuki (oki.miyuki at gmail dot com)
+//
+#include <string>
+#include <vector>
+#include <map>
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace rfc {
+namespace pop3 {
+
+//! number of body lines indexed for TOP
+const unsigned maildrop_top_lines  =  32;
+
+//! one message of maildrop
+struct maildrop_message {
+  std::string             uidl_;        //!< unique-id (UIDL)
+  std::string             file_;        //!< message file name (relative to maildrop directory)
+  unsigned                size_;        //!< message size in octets (bare LF counted as CRLF)
+  unsigned                header_end_;  //!< head of body (next of blank line)
+  std::vector<unsigned>   body_lines_;  //!< ends of first body lines (up to maildrop_top_lines)
+
+  //! constructor
+  maildrop_message();
+};
+
+//! index message file. (size, header end and first body lines)
+bool index_message( const std::string&, maildrop_message& );
+
+typedef std::vector<maildrop_message>            maildrop_list;
+typedef boost::shared_ptr<const maildrop_list>  maildrop_snapshot;
+
+//! message files to unlink after snapshots are released (see src/pop3maildrop.cpp)
+struct maildrop_unlinks;
+
+//! shared message index of one maildrop
+/*!
+  @note Index is copy-on-write. snapshot() hands out the current list, and
+    commit() builds a new list, so a snapshot never changes under a session.
+    The index is stored as "pop3.idx" in the maildrop directory. first line
+    is version "POP3IDX 2", and one "UIDL SIZE HEADER_END BODY_LINES FILE"
+    line per message follows. BODY_LINES is comma separated ends of first
+    body lines, or '-'. index of version 1 ("UIDL SIZE FILE" lines without
+    version line) is converted at load.
+  @note message file removed by commit() is unlinked after all snapshots
+    which list it are released. so session with older snapshot can still
+    RETR it.
+  @note index file changed by other process (e.g. delivery agent) is
+    reloaded at open (see maildrop_registry) and before append and commit.
+    index file is written under fcntl lock of "pop3.lock" in the maildrop
+    directory. other writers of index file must take same lock.
+*/
+class maildrop_index : private boost::noncopyable {
+public:
+  //! constructor. load index file of directory.
+  explicit maildrop_index( const std::string& );
+
+  //! take current snapshot
+  maildrop_snapshot snapshot() const;
+  //! append new message (for delivery agent)
+  bool append( const maildrop_message& );
+  //! index message file and append it (for delivery agent)
+  bool append( const std::string&, const std::string& );
+  //! remove deleted messages of snapshot. and rewrite index once.
+  bool commit( const maildrop_snapshot&, const std::vector<bool>& );
+  //! reload index file if it is changed by other process
+  void refresh();
+  //! maildrop directory
+  const std::string& directory() const;
+
+private:
+  //! load index file
+  void load();
+  //! rewrite index file
+  bool rewrite( const maildrop_list& ) const;
+  //! full path of file in maildrop directory
+  std::string path_of( const std::string& ) const;
+
+private:
+  //! wrap list as snapshot of current generation
+  maildrop_snapshot publish( maildrop_list* ) const;
+  //! record identity of index file. (after load or write)
+  void stamp();
+  //! inspect index file is changed after load or write
+  bool changed() const;
+  //! get identity of index file
+  void index_stat( boost::uint64_t&, boost::uint64_t&, boost::int64_t& ) const;
+
+private:
+  std::string           directory_;
+  mutable boost::mutex  mutex_;         //!< guards current_ only
+  boost::mutex          commit_mutex_;  //!< serializes append/commit and index rewrite
+  boost::shared_ptr<maildrop_unlinks>  generation_;  //!< generation of lists published since last commit
+  maildrop_snapshot     current_;
+  boost::uint64_t       index_ino_;     //!< inode of index file at last load or write
+  boost::uint64_t       index_size_;    //!< size of index file at last load or write
+  boost::int64_t        index_mtime_;   //!< mtime of index file at last load or write
+};
+
+//! maildrop registry. sessions for same maildrop share one maildrop_index.
+class maildrop_registry : private boost::noncopyable {
+public:
+  //! open (or share) maildrop index of directory. (blocking)
+  boost::shared_ptr<maildrop_index> open( const std::string& );
+
+private:
+  boost::mutex                                                mutex_;
+  std::map< std::string, boost::weak_ptr<maildrop_index> >  drops_;
+};
+
+//! per session view of maildrop
+/*!
+  @note attach() at PASS takes snapshot. DELE and RSET only change deletion
+    bitmap of this view. commit() at QUIT (UPDATE state) removes all marked
+    messages in one batch.
+  @attention message number is 1 origin (RFC 1939).
+*/
+class maildrop_view {
+public:
+  //! constructor
+  maildrop_view();
+
+  //! take snapshot of maildrop
+  void attach( const boost::shared_ptr<maildrop_index>& );
+  //! release snapshot without commit
+  void detach();
+  //! inspect view is attached
+  bool attached() const;
+
+  //! inspect message number is exist and not deleted
+  bool valid( unsigned ) const;
+  //! get message
+  const maildrop_message& message( unsigned ) const;
+  //! get full path of message file
+  std::string path( unsigned ) const;
+  //! number of messages in snapshot (include deleted)
+  unsigned size() const;
+  //! number of messages (exclude deleted)
+  unsigned count() const;
+  //! total octets of messages (exclude deleted)
+  unsigned long octets() const;
+  //! length of TOP response range from head of message
+  bool top_length( unsigned, unsigned, unsigned long& ) const;
+
+  //! mark message as deleted
+  bool dele( unsigned );
+  //! unmark all deleted messages
+  void rset();
+  //! commit deletions to maildrop. and detach.
+  bool commit();
+
+private:
+  boost::shared_ptr<maildrop_index>  index_;
+  maildrop_snapshot                  snapshot_;
+  std::vector<bool>                  deleted_;
+  unsigned                           deleted_count_;
+  unsigned long                      deleted_octets_;
+};
+
+}  // namespace pop3
+}  // namespace rfc
+
+#endif  // POP3MAILDROP_HPP
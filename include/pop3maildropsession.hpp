@@ -0,0 +1,87 @@
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+# pragma once
+#endif // defined(_MSC_VER) && (_MSC_VER >= 1200)
+#ifndef POP3MAILDROPSESSION_HPP
+#define POP3MAILDROPSESSION_HPP
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+//
+// Copyright (c) 2006-2009 OKI Miyuki (oki.miyuki at gmail dot com)
+//
+#include <string>
+#include <sstream>
+#include <pop3server.hpp>
+#include <pop3maildrop.hpp>
+#include <pop3diskio.hpp>
+
+namespace rfc {
+namespace pop3 {
+
+//! maildrop directory backed pop3 session
+/*!
+  @note Derived must have this member function.
+    @li bool authorize( const std::string& user, const std::string& pass, std::string& directory );
+  @note PASS opens shared maildrop_index on disk_io_executor, and attaches
+    maildrop_view to it (snapshot).
+    RETR and TOP are read from message files by disk_io_executor. DELE and
+    RSET only change the view, and QUIT in transaction commits deletions
+    on disk_io_executor.
+*/
+template <typename Derived, typename Stream = boost::asio::ip::tcp::socket>
+class maildrop_session :
+  public pop3_session< Derived, Stream >
+{
+public:
+  typedef pop3_session< Derived, Stream >  base_type;
+
+  //! constructor
+  maildrop_session( boost::asio::io_service& );
+
+  //! do PASS command
+  void response_pass( const std::string&, const std::string& );
+  //! do STAT command
+  void response_stat();
+  //! do LIST command
+  void response_list( unsigned );
+  //! do LIST command
+  void response_list();
+  //! do RETR command
+  void response_retr( unsigned );
+  //! do DELE command
+  void response_dele( unsigned );
+  //! do RSET command
+  void response_rset();
+  //! do TOP command
+  void response_top( unsigned, unsigned );
+  //! do UIDL command
+  void response_uidl( unsigned );
+  //! do UIDL command
+  void response_uidl();
+  //! do QUIT command
+  void response_quit();
+  //! write one line of LIST or UIDL listing
+  bool listing_line( bool, unsigned, std::ostream& );
+
+  //! shared maildrop registry
+  static maildrop_registry& registry();
+  //! shared disk I/O executor
+  static disk_io_executor& executor();
+
+protected:
+  //! handling completion of open. (PASS)
+  void handle_open( boost::shared_ptr<maildrop_index> );
+  //! handling completion of commit. (QUIT)
+  void handle_commit( bool );
+
+protected:
+  maildrop_view  view_;
+};
+
+#include <pop3maildropsession.ipp>
+
+}  // namespace pop3
+}  // namespace rfc
+
+#endif  // POP3MAILDROPSESSION_HPP
@@ -0,0 +1,231 @@
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+//
+// Copyright (c) 2006-2009 OKI Miyuki (oki.miyuki at gmail dot com)
+//
+
+//namespace rfc {
+//namespace pop3 {
+
+//! constructor
+template <typename Derived, typename Stream>
+maildrop_session<Derived, Stream>::maildrop_session(
+  boost::asio::io_service& io_service
+) :
+  base_type( io_service ),
+  view_()
+{
+}
+
+//! shared maildrop registry
+template <typename Derived, typename Stream>
+maildrop_registry& maildrop_session<Derived, Stream>::registry() {
+  static maildrop_registry  instance;
+  return instance;
+}
+
+//! shared disk I/O executor
+template <typename Derived, typename Stream>
+disk_io_executor& maildrop_session<Derived, Stream>::executor() {
+  static disk_io_executor  instance;
+  return instance;
+}
+
+//! do PASS command
+/*!
+  @note maildrop index is opened on disk_io_executor (it may load and
+    convert index of whole maildrop), and maildrop is announced at completion.
+*/
+template <typename Derived, typename Stream>
+void maildrop_session<Derived, Stream>::response_pass(
+  const std::string& user,  //!< [in] mail account (user) name
+  const std::string& pass   //!< [in] mail account (user) password
+) {
+  std::string  directory;
+  Derived*  parent  =  static_cast<Derived*>( this );
+  if( !parent->authorize( user, pass, directory ) ) {
+    this->state_.invalidate_user();
+    this->send_single_response( false, "invalid user or password" );
+    return;
+  }
+  // password is accepted. (login is charged to account)
+  this->state_.into_transaction();
+  executor().async_call(
+    this->io_service_,
+    boost::bind( &maildrop_registry::open, &registry(), directory ),
+    boost::bind( &maildrop_session::handle_open, boost::static_pointer_cast<maildrop_session>( this->shared_from_this() ), _1 )
+  );
+  this->reset_timer();
+}
+
+//! handling completion of open. (PASS)
+template <typename Derived, typename Stream>
+void maildrop_session<Derived, Stream>::handle_open(
+  boost::shared_ptr<maildrop_index>  index  //!< [in] opened maildrop index
+) {
+  view_.attach( index );
+  std::ostringstream  oss;
+  oss << "maildrop has " << view_.count() << " messages (" << view_.octets() << " octets)";
+  this->send_single_response( true, oss.str() );
+}
+
+//! do STAT command
+template <typename Derived, typename Stream>
+void maildrop_session<Derived, Stream>::response_stat() {
+  std::ostringstream  oss;
+  oss << view_.count() << " " << view_.octets();
+  this->send_single_response( true, oss.str() );
+}
+
+//! do LIST command
+template <typename Derived, typename Stream>
+void maildrop_session<Derived, Stream>::response_list(
+  unsigned number  //!< [in] message number
+) {
+  if( !view_.valid( number ) ) {
+    this->send_single_response( false, "no such message" );
+    return;
+  }
+  std::ostringstream  oss;
+  oss << number << " " << view_.message( number ).size_;
+  this->send_single_response( true, oss.str() );
+}
+
+//! do LIST command
+template <typename Derived, typename Stream>
+void maildrop_session<Derived, Stream>::response_list() {
+  this->send_listing_response( false, "scan listing follows", view_.size() );
+}
+
+//! do UIDL command
+template <typename Derived, typename Stream>
+void maildrop_session<Derived, Stream>::response_uidl(
+  unsigned number  //!< [in] message number
+) {
+  if( !view_.valid( number ) ) {
+    this->send_single_response( false, "no such message" );
+    return;
+  }
+  std::ostringstream  oss;
+  oss << number << " " << view_.message( number ).uidl_;
+  this->send_single_response( true, oss.str() );
+}
+
+//! do UIDL command
+template <typename Derived, typename Stream>
+void maildrop_session<Derived, Stream>::response_uidl() {
+  this->send_listing_response( true, "unique-id listing follows", view_.size() );
+}
+
+//! write one line of LIST or UIDL listing
+template <typename Derived, typename Stream>
+bool maildrop_session<Derived, Stream>::listing_line(
+  bool            uidl,   //!< [in] true: UIDL, false: LIST
+  unsigned        number, //!< [in] message number
+  std::ostream&   os      //!< [out,ref] response
+) {
+  if( !view_.valid( number ) )  return false;
+  if( uidl )  os << number << " " << view_.message( number ).uidl_;
+  else        os << number << " " << view_.message( number ).size_;
+  return true;
+}
+
+//! do RETR command
+template <typename Derived, typename Stream>
+void maildrop_session<Derived, Stream>::response_retr(
+  unsigned number  //!< [in] message number
+) {
+  if( !view_.valid( number ) ) {
+    this->send_single_response( false, "no such message" );
+    return;
+  }
+  const maildrop_message&  msg  =  view_.message( number );
+  std::ostringstream  oss;
+  oss << msg.size_ << " octets";
+  // size_ counts CR inserted before bare LF. so range may be longer than
+  // file, and transfer ends at end of file.
+  this->send_file_response( executor(), oss.str(), view_.path( number ), 0, msg.size_ );
+}
+
+//! do TOP command
+/*!
+  @note range is taken from index when body lines are indexed. otherwise
+    body lines are counted while reading.
+*/
+template <typename Derived, typename Stream>
+void maildrop_session<Derived, Stream>::response_top(
+  unsigned number,  //!< [in] message number
+  unsigned lines    //!< [in] number of body lines
+) {
+  if( !view_.valid( number ) ) {
+    this->send_single_response( false, "no such message" );
+    return;
+  }
+  unsigned long  length  =  0;
+  if( view_.top_length( number, lines, length ) ) {
+    this->send_file_response( executor(), "top of message follows", view_.path( number ), 0, length );
+  } else {
+    this->send_file_response(
+      executor(), "top of message follows", view_.path( number ), 0, length,
+      view_.message( number ).header_end_, lines );
+  }
+}
+
+//! do DELE command
+template <typename Derived, typename Stream>
+void maildrop_session<Derived, Stream>::response_dele(
+  unsigned number  //!< [in] message number
+) {
+  if( !view_.dele( number ) ) {
+    this->send_single_response( false, "no such message" );
+    return;
+  }
+  this->send_single_response( true, "message deleted" );
+}
+
+//! do RSET command
+template <typename Derived, typename Stream>
+void maildrop_session<Derived, Stream>::response_rset() {
+  view_.rset();
+  this->send_single_response( true, "maildrop reset" );
+}
+
+//! do QUIT command
+/*!
+  @note in transaction, deleted messages are removed from maildrop here. (UPDATE state)
+    commit runs on disk_io_executor, and good bye is sent at completion.
+*/
+template <typename Derived, typename Stream>
+void maildrop_session<Derived, Stream>::response_quit() {
+  if( view_.attached() && this->state_.in_transaction() ) {
+    executor().async_call(
+      this->io_service_,
+      boost::bind( &maildrop_view::commit, &view_ ),
+      boost::bind( &maildrop_session::handle_commit, boost::static_pointer_cast<maildrop_session>( this->shared_from_this() ), _1 )
+    );
+    this->reset_timer();
+    return;
+  }
+  base_type::response_quit();
+}
+
+//! handling completion of commit. (QUIT)
+/*!
+  @note RFC 1939 UPDATE state: if some deleted messages are not removed,
+    -ERR is sent. so client keeps its copy of them.
+*/
+template <typename Derived, typename Stream>
+void maildrop_session<Derived, Stream>::handle_commit(
+  bool  committed //!< [in] all deleted messages are removed
+) {
+  if( !committed ) {
+    this->send_quit_response( "-ERR some deleted messages not removed\r\n" );
+    return;
+  }
+  base_type::response_quit();
+}
+
+//}  // namespace pop3
+//}  // namespace rfc
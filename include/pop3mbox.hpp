@@ -0,0 +1,190 @@
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+# pragma once
+#endif // defined(_MSC_VER) && (_MSC_VER >= 1200)
+#ifndef POP3MBOX_HPP
+#define POP3MBOX_HPP
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+//
+// Copyright (c) 2006-2009 OKI Miyuki (oki.miyuki at gmail dot com)
+//
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <sstream>
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <pop3server.hpp>
+
+namespace rfc {
+namespace pop3 {
+
+//! number of body lines indexed for TOP
+const unsigned mbox_top_lines  =  32;
+
+//! index of one message in mbox file
+/*!
+  @note all positions are byte offset from head of mbox file.
+*/
+struct mbox_entry {
+  boost::uint64_t               from_;        //!< head of "From " separator line
+  boost::uint64_t               offset_;      //!< head of message (next of separator line)
+  boost::uint64_t               length_;      //!< message length (exclude trailing blank line)
+  boost::uint64_t               header_end_;  //!< head of body (next of blank line)
+  boost::uint64_t               octets_;      //!< size on POP3 (CRLF line end, unquoted)
+  boost::uint64_t               uidl_;        //!< hash of separator line and header (numbered if same)
+  std::vector<boost::uint64_t>  dots_;        //!< heads of line beginning with '.'
+  std::vector<boost::uint64_t>  quoted_;      //!< heads of ">From " line (mboxrd quoting)
+  std::vector<boost::uint32_t>  body_lines_;  //!< ends of first body lines from header_end_ (up to mbox_top_lines)
+};
+
+//! memory mapped mbox file and its message index
+/*!
+  @note Index is built by one memchr driven scan over the mapping, and cached
+    as "<mbox>.pidx" next to the file. The cache is used while size and mtime
+    of the mbox file are unchanged.
+*/
+class mbox_file : private boost::noncopyable {
+public:
+  //! constructor. map file and load or build index.
+  explicit mbox_file( const std::string& );
+
+  //! mbox file path
+  const std::string& path() const;
+  //! number of messages
+  std::size_t size() const;
+  //! get message index (0 origin)
+  const mbox_entry& entry( std::size_t ) const;
+  //! inspect file is changed after open
+  bool stale() const;
+
+  //! build response buffers of one chunk of message. (RETR and TOP)
+  boost::uint64_t segments( std::size_t, boost::uint64_t, boost::uint64_t, std::size_t, std::vector<boost::asio::const_buffer>& ) const;
+  //! end position of header and first lines of body. (TOP)
+  boost::uint64_t top_end( std::size_t, unsigned ) const;
+  //! write mbox without messages of uidls. (QUIT)
+  bool rewrite( const std::set<boost::uint64_t>& ) const;
+
+private:
+  //! build index by scanning mapping
+  void build();
+  //! load index cache
+  bool load_cache();
+  //! save index cache
+  void save_cache() const;
+  //! append range with CRLF conversion
+  void append_range( boost::uint64_t, boost::uint64_t, std::vector<boost::asio::const_buffer>& ) const;
+  //! head of mapping
+  const char* data() const;
+
+private:
+  std::string                           path_;
+  boost::uint64_t                       file_size_;
+  boost::int64_t                        mtime_;
+  bool                                  crlf_;      //!< all lines end with CRLF
+  boost::interprocess::file_mapping     mapping_;
+  boost::interprocess::mapped_region    region_;
+  std::vector<mbox_entry>               entries_;
+};
+
+//! mbox registry. sessions for same mbox share one mbox_file.
+class mbox_registry : private boost::noncopyable {
+public:
+  //! open (or share) mbox file. (blocking)
+  boost::shared_ptr<mbox_file> open( const std::string& );
+  //! remove messages of uidls from mbox file. (blocking)
+  bool commit( const std::string&, const std::set<boost::uint64_t>& );
+
+private:
+  boost::mutex                                          mutex_;
+  std::map< std::string, boost::weak_ptr<mbox_file> >  files_;
+};
+
+//! mbox backed pop3 session
+/*!
+  @note Derived must have this member function.
+    @li bool authorize( const std::string& user, const std::string& pass, std::string& mbox_path );
+  @note PASS opens mbox file (mapping and index) on disk_io_executor, and
+    "+OK" of PASS is sent after that. RETR and TOP are written from mapping
+    of mbox file directly. DELE and RSET are kept in session, and QUIT in
+    transaction removes deleted messages from mbox file on disk_io_executor.
+    "+OK" of QUIT is sent after that.
+  @attention QUIT replaces mbox file by rename under "<mbox>.lock". delivery
+    agents must take this dotlock. message appended under fcntl lock only may
+    be lost by the rename.
+*/
+template <typename Derived, typename Stream = boost::asio::ip::tcp::socket>
+class mbox_session :
+  public pop3_session< Derived, Stream >
+{
+public:
+  typedef pop3_session< Derived, Stream >  base_type;
+
+  //! constructor
+  mbox_session( boost::asio::io_service& );
+
+  //! do PASS command
+  void response_pass( const std::string&, const std::string& );
+  //! do STAT command
+  void response_stat();
+  //! do LIST command
+  void response_list( unsigned );
+  //! do LIST command
+  void response_list();
+  //! do RETR command
+  void response_retr( unsigned );
+  //! do DELE command
+  void response_dele( unsigned );
+  //! do RSET command
+  void response_rset();
+  //! do TOP command
+  void response_top( unsigned, unsigned );
+  //! do UIDL command
+  void response_uidl( unsigned );
+  //! do UIDL command
+  void response_uidl();
+  //! do QUIT command
+  void response_quit();
+  //! write one line of LIST or UIDL listing
+  bool listing_line( bool, unsigned, std::ostream& );
+
+  //! shared mbox registry
+  static mbox_registry& registry();
+  //! shared disk I/O executor
+  static disk_io_executor& executor();
+
+protected:
+  //! inspect message number is exist and not deleted
+  bool valid( unsigned ) const;
+  //! send message range from mapping
+  void send_mbox_response( unsigned, boost::uint64_t, const std::string& );
+  //! write one chunk of message range
+  void send_mbox_chunk( boost::shared_ptr<mbox_file>, unsigned, boost::uint64_t, boost::uint64_t, boost::shared_ptr<std::string> );
+  //! handling write completion of chunk
+  void handle_mbox_wrote(
+    boost::shared_ptr<mbox_file>, unsigned, boost::uint64_t, boost::uint64_t, boost::shared_ptr<std::string>,
+    boost::shared_ptr< std::vector<boost::asio::const_buffer> >, const boost::system::error_code& );
+  //! handling completion of open. (PASS)
+  void handle_open( boost::shared_ptr<mbox_file> );
+  //! handling completion of commit. (QUIT)
+  void handle_commit( bool );
+
+protected:
+  boost::shared_ptr<mbox_file>  mbox_;
+  std::vector<bool>             deleted_;
+};
+
+#include <pop3mbox.ipp>
+
+}  // namespace pop3
+}  // namespace rfc
+
+#endif  // POP3MBOX_HPP
@@ -0,0 +1,313 @@
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+//
+// Copyright (c) 2006-2009 OKI Miyuki (oki.miyuki at gmail dot com)
+//
+
+//namespace rfc {
+//namespace pop3 {
+
+//! constructor
+template <typename Derived, typename Stream>
+mbox_session<Derived, Stream>::mbox_session(
+  boost::asio::io_service& io_service
+) :
+  base_type( io_service ),
+  mbox_(),
+  deleted_()
+{
+}
+
+//! shared mbox registry
+template <typename Derived, typename Stream>
+mbox_registry& mbox_session<Derived, Stream>::registry() {
+  static mbox_registry  instance;
+  return instance;
+}
+
+//! shared disk I/O executor
+template <typename Derived, typename Stream>
+disk_io_executor& mbox_session<Derived, Stream>::executor() {
+  static disk_io_executor  instance;
+  return instance;
+}
+
+//! inspect message number is exist and not deleted
+template <typename Derived, typename Stream>
+bool mbox_session<Derived, Stream>::valid(
+  unsigned number  //!< [in] message number (1 origin)
+) const {
+  return mbox_ && 0 < number && number <= mbox_->size() && !deleted_[ number - 1 ];
+}
+
+//! do PASS command
+/*!
+  @note mbox is opened on disk_io_executor (it may build index of whole
+    file), and maildrop is announced at completion.
+*/
+template <typename Derived, typename Stream>
+void mbox_session<Derived, Stream>::response_pass(
+  const std::string& user,  //!< [in] mail account (user) name
+  const std::string& pass   //!< [in] mail account (user) password
+) {
+  std::string  path;
+  Derived*  parent  =  static_cast<Derived*>( this );
+  if( !parent->authorize( user, pass, path ) ) {
+    this->state_.invalidate_user();
+    this->send_single_response( false, "invalid user or password" );
+    return;
+  }
+  // password is accepted. (login is charged to account)
+  this->state_.into_transaction();
+  executor().async_call(
+    this->io_service_,
+    boost::bind( &mbox_registry::open, &registry(), path ),
+    boost::bind( &mbox_session::handle_open, boost::static_pointer_cast<mbox_session>( this->shared_from_this() ), _1 )
+  );
+  this->reset_timer();
+}
+
+//! handling completion of open. (PASS)
+/*!
+  @note if mbox can not be opened, -ERR is sent and connection is closed.
+    (session is already in transaction)
+*/
+template <typename Derived, typename Stream>
+void mbox_session<Derived, Stream>::handle_open(
+  boost::shared_ptr<mbox_file>  file  //!< [in] opened mbox file, or null
+) {
+  if( !file ) {
+    this->send_quit_response( "-ERR [SYS/TEMP] unable to open maildrop\r\n" );
+    return;
+  }
+  mbox_  =  file;
+  deleted_.assign( mbox_->size(), false );
+  std::ostringstream  oss;
+  oss << "maildrop has " << mbox_->size() << " messages";
+  this->send_single_response( true, oss.str() );
+}
+
+//! do STAT command
+template <typename Derived, typename Stream>
+void mbox_session<Derived, Stream>::response_stat() {
+  unsigned         count   =  0;
+  boost::uint64_t  octets  =  0;
+  for( unsigned i = 1; i <= mbox_->size(); ++i ) {
+    if( !valid( i ) )  continue;
+    ++count;
+    octets  +=  mbox_->entry( i - 1 ).octets_;
+  }
+  std::ostringstream  oss;
+  oss << count << " " << octets;
+  this->send_single_response( true, oss.str() );
+}
+
+//! do LIST command
+template <typename Derived, typename Stream>
+void mbox_session<Derived, Stream>::response_list(
+  unsigned number  //!< [in] message number
+) {
+  if( !valid( number ) ) {
+    this->send_single_response( false, "no such message" );
+    return;
+  }
+  std::ostringstream  oss;
+  oss << number << " " << mbox_->entry( number - 1 ).octets_;
+  this->send_single_response( true, oss.str() );
+}
+
+//! do LIST command
+template <typename Derived, typename Stream>
+void mbox_session<Derived, Stream>::response_list() {
+  this->send_listing_response( false, "scan listing follows", static_cast<unsigned>( mbox_->size() ) );
+}
+
+//! do UIDL command
+template <typename Derived, typename Stream>
+void mbox_session<Derived, Stream>::response_uidl(
+  unsigned number  //!< [in] message number
+) {
+  if( !valid( number ) ) {
+    this->send_single_response( false, "no such message" );
+    return;
+  }
+  std::ostringstream  oss;
+  oss << number << " " << std::hex << mbox_->entry( number - 1 ).uidl_;
+  this->send_single_response( true, oss.str() );
+}
+
+//! do UIDL command
+template <typename Derived, typename Stream>
+void mbox_session<Derived, Stream>::response_uidl() {
+  this->send_listing_response( true, "unique-id listing follows", static_cast<unsigned>( mbox_->size() ) );
+}
+
+//! write one line of LIST or UIDL listing
+template <typename Derived, typename Stream>
+bool mbox_session<Derived, Stream>::listing_line(
+  bool            uidl,   //!< [in] true: UIDL, false: LIST
+  unsigned        number, //!< [in] message number
+  std::ostream&   os      //!< [out,ref] response
+) {
+  if( !valid( number ) )  return false;
+  if( uidl )  os << std::dec << number << " " << std::hex << mbox_->entry( number - 1 ).uidl_;
+  else        os << std::dec << number << " " << mbox_->entry( number - 1 ).octets_;
+  return true;
+}
+
+//! do RETR command
+template <typename Derived, typename Stream>
+void mbox_session<Derived, Stream>::response_retr(
+  unsigned number  //!< [in] message number
+) {
+  if( !valid( number ) ) {
+    this->send_single_response( false, "no such message" );
+    return;
+  }
+  const mbox_entry&  e  =  mbox_->entry( number - 1 );
+  std::ostringstream  oss;
+  oss << e.octets_ << " octets";
+  send_mbox_response( number, e.offset_ + e.length_, oss.str() );
+}
+
+//! do TOP command
+template <typename Derived, typename Stream>
+void mbox_session<Derived, Stream>::response_top(
+  unsigned number,  //!< [in] message number
+  unsigned lines    //!< [in] number of body lines
+) {
+  if( !valid( number ) ) {
+    this->send_single_response( false, "no such message" );
+    return;
+  }
+  send_mbox_response( number, mbox_->top_end( number - 1, lines ), "top of message follows" );
+}
+
+//! do DELE command
+template <typename Derived, typename Stream>
+void mbox_session<Derived, Stream>::response_dele(
+  unsigned number  //!< [in] message number
+) {
+  if( !valid( number ) ) {
+    this->send_single_response( false, "no such message" );
+    return;
+  }
+  deleted_[ number - 1 ]  =  true;
+  this->send_single_response( true, "message deleted" );
+}
+
+//! do RSET command
+template <typename Derived, typename Stream>
+void mbox_session<Derived, Stream>::response_rset() {
+  deleted_.assign( deleted_.size(), false );
+  this->send_single_response( true, "maildrop reset" );
+}
+
+//! do QUIT command
+/*!
+  @note in transaction, deleted messages are removed from mbox file here. (UPDATE state)
+    rewrite of mbox runs on disk_io_executor, and good bye is sent at completion.
+*/
+template <typename Derived, typename Stream>
+void mbox_session<Derived, Stream>::response_quit() {
+  if( mbox_ && this->state_.in_transaction() ) {
+    std::set<boost::uint64_t>  uidls;
+    for( std::size_t i = 0; i < deleted_.size(); ++i ) {
+      if( deleted_[i] )  uidls.insert( mbox_->entry( i ).uidl_ );
+    }
+    std::string  path  =  mbox_->path();
+    mbox_.reset();
+    if( !uidls.empty() ) {
+      executor().async_call(
+        this->io_service_,
+        boost::bind( &mbox_registry::commit, &registry(), path, uidls ),
+        boost::bind( &mbox_session::handle_commit, boost::static_pointer_cast<mbox_session>( this->shared_from_this() ), _1 )
+      );
+      this->reset_timer();
+      return;
+    }
+  }
+  base_type::response_quit();
+}
+
+//! handling completion of commit. (QUIT)
+/*!
+  @note RFC 1939 UPDATE state: if deleted messages are not removed (e.g. mbox
+    is locked by other process), -ERR is sent. so client keeps its copy of them.
+*/
+template <typename Derived, typename Stream>
+void mbox_session<Derived, Stream>::handle_commit(
+  bool  committed //!< [in] deleted messages are removed
+) {
+  if( !committed ) {
+    this->send_quit_response( "-ERR some deleted messages not removed\r\n" );
+    return;
+  }
+  base_type::response_quit();
+}
+
+//! send message range from mapping
+/*!
+  @note message is written in chunks of at most low watermark. so buffer
+    list of one write stays small, and idle timer is reset per chunk.
+*/
+template <typename Derived, typename Stream>
+void mbox_session<Derived, Stream>::send_mbox_response(
+  unsigned            number, //!< [in] message number
+  boost::uint64_t     last,   //!< [in] end position of response
+  const std::string&  msg     //!< [in] additional information of +OK line
+) {
+  boost::shared_ptr<std::string>  head( new std::string( "+OK " + msg + "\r\n" ) );
+  boost::uint64_t  first  =  mbox_->entry( number - 1 ).offset_;
+  this->charge_octets( static_cast<unsigned long>( last - first ) );
+  send_mbox_chunk( mbox_, number, first, last, head );
+  this->reset_timer();
+}
+
+//! write one chunk of message range
+/*!
+  @note response buffers point into mapping of mbox file. so mbox_file and
+    buffers are held until write completion.
+*/
+template <typename Derived, typename Stream>
+void mbox_session<Derived, Stream>::send_mbox_chunk(
+  boost::shared_ptr<mbox_file>    file,   //!< [in] mbox file of response
+  unsigned                        number, //!< [in] message number
+  boost::uint64_t                 first,  //!< [in] start position of chunk
+  boost::uint64_t                 last,   //!< [in] end position of response
+  boost::shared_ptr<std::string>  head    //!< [in] +OK line (first chunk only)
+) {
+  boost::shared_ptr< std::vector<boost::asio::const_buffer> >  buffers( new std::vector<boost::asio::const_buffer>() );
+  if( head )  buffers->push_back( boost::asio::buffer( *head ) );
+  boost::uint64_t  stop  =  file->segments( number - 1, first, last, base_type::limits().low_watermark_, *buffers );
+  boost::asio::async_write(
+    this->socket_, *buffers,
+    boost::bind(
+      &mbox_session::handle_mbox_wrote, boost::static_pointer_cast<mbox_session>( this->shared_from_this() ),
+      file, number, stop, last, head, buffers, boost::asio::placeholders::error )
+  );
+}
+
+//! handling write completion of chunk
+template <typename Derived, typename Stream>
+void mbox_session<Derived, Stream>::handle_mbox_wrote(
+  boost::shared_ptr<mbox_file>                                  file,
+  unsigned                                                      number,
+  boost::uint64_t                                               pos,
+  boost::uint64_t                                               last,
+  boost::shared_ptr<std::string>,
+  boost::shared_ptr< std::vector<boost::asio::const_buffer> >,
+  const boost::system::error_code&                              error
+) {
+  if( error || pos == last ) {
+    this->handle_wrote( error );
+    return;
+  }
+  this->reset_timer();
+  send_mbox_chunk( file, number, pos, last, boost::shared_ptr<std::string>() );
+}
+
+//}  // namespace pop3
+//}  // namespace rfc
@@ -12,12 +12,12 @@
 //
 #include <iostream>
 #include <string>
-#include <deque>
 #include <boost/bind.hpp>
 #include <boost/any.hpp>
 #include <boost/spirit/include/classic.hpp>
 #include <boost/logic/tribool.hpp>
 #include <boost/assert.hpp>
+#include <boost/noncopyable.hpp>
 
 
 // RFC 1939
@@ -64,19 +64,51 @@ enum pop3_process_type {
   pop3_process_quit,
 };
 
+//! command arguments queue (FIFO)
+/*!
+  @note POP3 command has two arguments at most. so arguments are kept in
+    fixed slots, and no memory is allocated unlike std::deque.
+  @attention arguments over capacity are ignored. (only on error path)
+*/
+class pop3_arguments {
+public:
+  enum { capacity = 2 };
+
+  //! constructor
+  pop3_arguments();
+
+  //! append argument
+  void push_back( const boost::any& );
+  //! first argument
+  boost::any& front();
+  //! remove first argument
+  void pop_front();
+  //! remove all arguments
+  void clear();
+  //! inspect queue is empty
+  bool empty() const;
+
+private:
+  boost::any      argv_[capacity];
+  unsigned char   head_;
+  unsigned char   size_;
+};
+
 //! pop3 state
 /*!
   @note treat POP3 server's state and parser result.
+  @note state flags are packed, and result_ points to static message. so
+    pop3_state has no allocated memory between commands.
 */
 struct pop3_state {
   // for state
-  bool                      apop_support_;    //!< true: APOP support, false: APOP unsupport
-  bool                      in_transaction_;  //!< true: in transaction, false: out of transaction
-  bool                      uname_active_;    //!< true: now USER command was accepted, false: other
+  bool                      apop_support_   : 1;  //!< true: APOP support, false: APOP unsupport
+  bool                      in_transaction_ : 1;  //!< true: in transaction, false: out of transaction
+  bool                      uname_active_   : 1;  //!< true: now USER command was accepted, false: other
   // results
-  pop3_command_type         cmd_type_;
-  std::string               result_;
-  std::deque<boost::any>    argv_;
+  pop3_command_type         cmd_type_       : 8;
+  const char*               result_;              //!< error message (static string)
+  pop3_arguments            argv_;
 
   //! constructor
   explicit pop3_state( bool apop_support );
@@ -113,7 +145,7 @@ struct pop3_state {
   //! change state to 'transaction mode.'
   void into_transaction();
   //! inspect state is 'transaction mode?'
-  bool pop3_state::in_transaction() const;
+  bool in_transaction() const;
   //! change state to 'accept PASS command.'
   void validate_user();
   //! change state to 'accept USER command.'
@@ -129,16 +161,24 @@ struct pop3_command_symbols :
 };
 
 //! pop3 command grammar class for pop3server
+/*!
+  @note rules are built from state at first parse, and results are set to
+    state bound at parse time. so grammar may be reused for states with same
+    flags. (see pop3_command_parser)
+*/
 template <typename IterT>
 class pop3_command_grammar :
   public boost::spirit::classic::grammar< pop3_command_grammar<IterT> >
 {
 public:
-  pop3_state&            state_;
+  pop3_state*           state_;
   pop3_command_symbols  pop3_command_p;
 
   pop3_command_grammar( pop3_state& );
 
+  //! bind state to set results
+  void bind( pop3_state& );
+
   void set_command( pop3_command_type ct ) const;
   void set_uparam(unsigned uparam) const;
   void set_sparam( IterT const& begin, IterT const& end ) const;
@@ -187,6 +227,28 @@ public:
   };
 };
 
+//! pop3 command parser. keeps grammar for each state flags.
+/*!
+  @note building grammar rules costs much more than parsing a command line.
+    so one grammar is kept for each combination of state flags (APOP support,
+    in transaction, USER accepted), and reused.
+  @attention not thread safe. use one parser per thread.
+*/
+class pop3_command_parser : private boost::noncopyable {
+public:
+  //! constructor
+  pop3_command_parser();
+  //! destructor
+  ~pop3_command_parser();
+
+  //! parse command line. results are set to state.
+  bool parse( const std::string&, pop3_state& );
+
+private:
+  enum { grammar_count = 8 };
+  pop3_command_grammar<char const*>*  grammars_[grammar_count];
+};
+
 #include <pop3parser.ipp>
 
 } // namespace pop3
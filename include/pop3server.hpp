@@ -18,19 +18,47 @@
 #include <boost/thread.hpp>
 #include <boost/enable_shared_from_this.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/scoped_ptr.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/date_time/c_local_time_adjustor.hpp>
 #include <pop3parser.hpp>
+#include <pop3diskio.hpp>
+#include <pop3limiter.hpp>
+#include <pop3stream.hpp>
+#include <pop3buffer.hpp>
 
 namespace rfc {
 namespace pop3 {
 
-template <typename Pop3Session>
+//! per connection resource limits
+/*!
+  @note shared by all sessions of one Pop3Session type. see pop3_session::limits().
+*/
+struct pop3_limits {
+  std::size_t   max_command_line_;  //!< max command line length (include CRLF)
+  std::size_t   max_response_;      //!< max size of one buffered response
+  std::size_t   high_watermark_;    //!< file response does not read ahead above this outstanding size
+  std::size_t   low_watermark_;     //!< max size of one chunk of file response and listing response
+  boost::posix_time::time_duration  idle_timeout_;  //!< session is closed after no command for this
+  std::size_t   max_pooled_buffers_;  //!< max number of free buffers kept in each pool
+  std::size_t   max_pooled_capacity_; //!< buffer grown over this is freed, not pooled
+
+  //! constructor. set default limits.
+  pop3_limits();
+};
+
+//! pop3 session class
+/*!
+  @note Stream is socket type of session. (AsyncReadStream and AsyncWriteStream)
+    e.g. boost::asio::ip::tcp::socket, local_stream, memory_stream
+*/
+template <typename Pop3Session, typename Stream = boost::asio::ip::tcp::socket>
 class pop3_session : 
-  public boost::enable_shared_from_this< pop3_session<Pop3Session> >
+  public boost::enable_shared_from_this< pop3_session<Pop3Session, Stream> >
 {
 public:
-  typedef typename Pop3Session    session_type;
+  typedef Pop3Session             session_type;
+  typedef Stream                  stream_type;
 
   //@{
   /*!
@@ -71,16 +99,30 @@ public:
   void response_noop();
   //! do QUIT command
   void response_quit();
+  //! write one line of LIST or UIDL listing without CRLF. false if message is not listed. (for send_listing_response)
+  bool listing_line( bool, unsigned, std::ostream& );
   //@}
 
 public:
   //! constructor
   pop3_session( boost::asio::io_service& );
+  //! destructor. release admitted connection and buffers.
+  ~pop3_session();
 
+  //! set admission control. (before start)
+  void admission( boost::shared_ptr<admission_control> );
+  //! set client address. (before start, e.g. by proxy)
+  void peer( const std::string& );
   //! start handler
   void start();
-  //! get boost::asio::ip::tcp::socket
-  boost::asio::ip::tcp::socket& socket();
+  //! get stream of session
+  Stream& socket();
+  //! resource limits of this session type
+  static pop3_limits& limits();
+  //! pool of command line buffers of this session type
+  static buffer_pool& request_pool();
+  //! pool of response buffers of this session type
+  static buffer_pool& response_pool();
 
 protected:
   //! handling after "QUIT" command. (do quit)
@@ -89,6 +131,12 @@ protected:
   void handle_read( const boost::system::error_code& );
   //! send single line response.
   void send_single_response( bool, const std::string& );
+  //! send multi line listing response in chunks. (for LIST, UIDL)
+  void send_listing_response( bool, const std::string&, unsigned );
+  //! write next chunk of listing response.
+  void write_listing( bool, unsigned, unsigned );
+  //! handling chunk write completion of listing response.
+  void handle_listing_wrote( bool, unsigned, unsigned, const boost::system::error_code& );
   //! write quit response line. next do is disconnect.
   void send_quit_response( const std::string& );
   //! check session timeout and do.
@@ -97,21 +145,56 @@ protected:
   void handle_wrote( const boost::system::error_code& );
   //! reset timer count. and reserve timeout check (= handle_expire).
   void reset_timer();
+  //! wait next command. (read buffer is not taken until data arrives)
+  void start_read();
+  //! handling data arrival. take read buffer and read command line.
+  void handle_ready( const boost::system::error_code& );
+  //! take response buffer from pool
+  boost::asio::streambuf& response_buffer();
+  //! charge octets of response to admission control.
+  void charge_octets( unsigned long );
+  //! send multi line response from file range. (for RETR, TOP)
+  void send_file_response( disk_io_executor&, const std::string&, const std::string&, unsigned long, unsigned long );
+  //! send multi line response from file range, with limited body lines. (for TOP)
+  void send_file_response( disk_io_executor&, const std::string&, const std::string&, unsigned long, unsigned long, unsigned long, unsigned long );
+  //! start transfer. +OK line is written with first chunk.
+  void start_file_response( boost::shared_ptr<file_transfer>, const std::string& );
+  //! read-ahead size of file response. (= socket send buffer size)
+  std::size_t read_ahead_size();
+  //! read next chunk of file response.
+  void start_file_read( boost::shared_ptr<file_transfer> );
+  //! write chunk of file response.
+  void start_file_write( boost::shared_ptr<file_transfer>, boost::shared_ptr<std::string> );
+  //! handling chunk read completion of file response.
+  void handle_file_read( boost::shared_ptr<file_transfer>, const boost::system::error_code&, disk_io_executor::buffer_ptr );
+  //! handling chunk write completion of file response.
+  void handle_file_wrote( boost::shared_ptr<file_transfer>, boost::shared_ptr<std::string>, const boost::system::error_code& );
 
 private:
   //! parse "pop3 command" and call command.
   void parse_command( const std::string& );
 
 protected:
+  //@{
+  /*!
+    @note idle session holds no request or response buffer. request_ and
+      response_ are taken from pools only while reading or writing.
+      user_account_ and peer_ are heap strings when longer than small string
+      buffer of std::string (e.g. IPv6 address). members are declared in this
+      order for packing, and initialized in same order.
+      (see sample/idlebench.cpp for per-session memory)
+  */
   pop3_state                        state_;
+  bool                              discard_line_;  //!< skipping rest of too long command line
   boost::asio::io_service&          io_service_;
-  boost::asio::ip::tcp::socket      socket_;
+  Stream                            socket_;
   boost::asio::deadline_timer       timer_;
-  boost::posix_time::time_duration  session_time_duration_;
   std::string                       user_account_;
-  boost::asio::streambuf            request_;
-  boost::asio::streambuf            response_;
-
+  buffer_pool::buffer_type*         request_;       //!< command line buffer (null while idle)
+  buffer_pool::buffer_type*         response_;      //!< response buffer (null while idle)
+  boost::shared_ptr<admission_control>  admission_;  //!< admission control (null: unlimited)
+  std::string                       peer_;          //!< client IP address (empty: not limited per IP)
+  //@}
 };
 
 //typedef typename boost::shared_ptr< pop3_session<Pop3Session> >  session_ptr;
@@ -119,20 +202,28 @@ protected:
 #include <pop3session.ipp>
 
 //! pop3 server class
-template <typename Pop3Session>
+/*!
+  @note Acceptor accepts socket of Pop3Session. (Pop3Session::stream_type)
+    e.g. boost::asio::ip::tcp::acceptor, local_acceptor
+*/
+template <typename Pop3Session, typename Acceptor = boost::asio::ip::tcp::acceptor>
 class pop3_server {
 private:
   //! final pop3 session class type
-  typedef typename Pop3Session pop3_session_type;
-  typedef typename boost::shared_ptr<Pop3Session>  pop3_session_type_ptr;
+  typedef Pop3Session pop3_session_type;
+  typedef boost::shared_ptr<Pop3Session>  pop3_session_type_ptr;
   //! bind client connection 
   void bind_accept( pop3_session_type_ptr );
   //! handle first contact from pop3 client mailer.
   void handle_accept( pop3_session_type_ptr, const boost::system::error_code& );
 
 public:
-  //! constructor
-  pop3_server( boost::asio::io_service&, short );
+  typedef typename Acceptor::endpoint_type  endpoint_type;
+
+  //! constructor. listen TCP port of IPv4.
+  pop3_server( boost::asio::io_service&, short, boost::shared_ptr<admission_control> = boost::shared_ptr<admission_control>() );
+  //! constructor. listen endpoint. (e.g. path of Unix domain socket)
+  pop3_server( boost::asio::io_service&, const endpoint_type&, boost::shared_ptr<admission_control> = boost::shared_ptr<admission_control>() );
 
   //! start thread
   void start();
@@ -142,9 +233,10 @@ public:
   void stop();
 
 private:
-  std::auto_ptr<boost::thread>    runner_;
+  boost::scoped_ptr<boost::thread>  runner_;
   boost::asio::io_service&        io_service_;
-  boost::asio::ip::tcp::acceptor  acceptor_;
+  Acceptor                        acceptor_;
+  boost::shared_ptr<admission_control>  admission_;
 };
 
 #include <pop3server.ipp>
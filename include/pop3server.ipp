@@ -10,8 +10,8 @@
 //namespace pop3 {
 
 //! bind to async accept handler
-template <typename Pop3Session>
-void pop3_server<Pop3Session>::bind_accept( 
+template <typename Pop3Session, typename Acceptor>
+void pop3_server<Pop3Session, Acceptor>::bind_accept( 
   pop3_session_type_ptr session 
 ) {
   acceptor_.async_accept(
@@ -26,26 +26,44 @@ void pop3_server<Pop3Session>::bind_accept(
 }
 
 //! constructor
-template <typename Pop3Session>
-pop3_server<Pop3Session>::pop3_server( 
+template <typename Pop3Session, typename Acceptor>
+pop3_server<Pop3Session, Acceptor>::pop3_server( 
   boost::asio::io_service& io_service,
-  short port
+  short port,
+  boost::shared_ptr<admission_control> admission
 ) :
   io_service_(io_service),
-  acceptor_(io_service, boost::asio::ip::tcp::endpoint(boost::asio::ip::tcp::v4(), port))
+  acceptor_(io_service, boost::asio::ip::tcp::endpoint(boost::asio::ip::tcp::v4(), port)),
+  admission_(admission)
+{
+  pop3_session_type_ptr new_session( new pop3_session_type( io_service ) );
+  bind_accept( new_session );
+}
+
+//! constructor. listen endpoint. (e.g. path of Unix domain socket)
+template <typename Pop3Session, typename Acceptor>
+pop3_server<Pop3Session, Acceptor>::pop3_server( 
+  boost::asio::io_service& io_service,
+  const endpoint_type& endpoint,
+  boost::shared_ptr<admission_control> admission
+) :
+  io_service_(io_service),
+  acceptor_(io_service, endpoint),
+  admission_(admission)
 {
   pop3_session_type_ptr new_session( new pop3_session_type( io_service ) );
   bind_accept( new_session );
 }
 
 //! handle first contact from pop3 client mailer.
-template <typename Pop3Session>
-void pop3_server<Pop3Session>::handle_accept( 
+template <typename Pop3Session, typename Acceptor>
+void pop3_server<Pop3Session, Acceptor>::handle_accept( 
   pop3_session_type_ptr    new_session,
   const boost::system::error_code&  error
 ) {
   if( !error ) {
   std::cout << "hi" << std::endl;
+    new_session->admission( admission_ );
     new_session->start();
     new_session.reset( new pop3_session_type( io_service_ ) );
     bind_accept( new_session );
@@ -53,28 +71,28 @@ void pop3_server<Pop3Session>::handle_accept(
 }
 
 //! run thread
-template <typename Pop3Session>
-void pop3_server<Pop3Session>::run() {
+template <typename Pop3Session, typename Acceptor>
+void pop3_server<Pop3Session, Acceptor>::run() {
   io_service_.run();
 }
 
 //! start thread
-template <typename Pop3Session>
-void pop3_server<Pop3Session>::start() {
+template <typename Pop3Session, typename Acceptor>
+void pop3_server<Pop3Session, Acceptor>::start() {
   BOOST_ASSERT( !runner_.get() );
   runner_.reset( 
     new boost::thread(
-      boost::bind( &pop3_server<Pop3Session>::run, this )
+      boost::bind( &pop3_server<Pop3Session, Acceptor>::run, this )
     )
   );
 }
 
 //! stop thread
-template <typename Pop3Session>
-void pop3_server<Pop3Session>::stop() {
+template <typename Pop3Session, typename Acceptor>
+void pop3_server<Pop3Session, Acceptor>::stop() {
   BOOST_ASSERT( runner_.get() );
-  io_service_.interrupt();
-  runner_.join();
+  io_service_.stop();
+  runner_->join();
   runner_.reset();
 }
 
@@ -11,61 +11,175 @@
 //namespace rfc {
 //namespace pop3 {
 
+//! constructor. set default limits.
+/*!
+	@note max_command_line_ is RFC 2449 limit (255 octets include CRLF).
+	@note max_pooled_capacity_ keeps buffers of command lines and single line
+		responses pooled. buffer grown by large listing response is freed.
+*/
+inline pop3_limits::pop3_limits() :
+	max_command_line_( 255 ),
+	max_response_( 4 * 1024 * 1024 ),
+	high_watermark_( 256 * 1024 ),
+	low_watermark_( 64 * 1024 ),
+	//idle_timeout_( boost::posix_time::seconds(600) ),
+	idle_timeout_( boost::posix_time::seconds(15) ),
+	max_pooled_buffers_( 1024 ),
+	max_pooled_capacity_( 4096 )
+{
+}
+
 //! constructor
-template <typename Pop3Session>
-pop3_session<Pop3Session>::pop3_session(
+template <typename Pop3Session, typename Stream>
+pop3_session<Pop3Session, Stream>::pop3_session(
 	boost::asio::io_service&	io_service
 ) : 
+	state_(false),
+	discard_line_(false),
 	io_service_(io_service),
 	socket_(io_service),
 	timer_(io_service),
-	//session_time_duration_(boost::posix_time::seconds(600)),
-	session_time_duration_(boost::posix_time::seconds(15)),
-	state_(false)
+	user_account_(),
+	request_(0),
+	response_(0),
+	admission_(),
+	peer_()
 {
 }
 
+//! destructor. release admitted connection and buffers.
+template <typename Pop3Session, typename Stream>
+pop3_session<Pop3Session, Stream>::~pop3_session() {
+	if( admission_ )	admission_->release_connection();
+	request_pool().release( request_ );
+	response_pool().release( response_ );
+}
+
+//! set admission control. (before start)
+template <typename Pop3Session, typename Stream>
+void pop3_session<Pop3Session, Stream>::admission(
+	boost::shared_ptr<admission_control>	admission	//!< [in] admission control shared by server
+) {
+	admission_	=	admission;
+}
+
+//! set client address. (before start, e.g. by proxy)
+/*!
+	@note key of per IP admission control. if not set, address of stream is
+		used at start. (see peer_address)
+*/
+template <typename Pop3Session, typename Stream>
+void pop3_session<Pop3Session, Stream>::peer(
+	const std::string& address	//!< [in] client IP address
+) {
+	peer_	=	address;
+}
+
 //! start handler
-template <typename Pop3Session>
-void pop3_session<Pop3Session>::start() {
+/*!
+	@note over limit connection gets -ERR greeting and is closed. (RFC 2449 [SYS/TEMP])
+*/
+template <typename Pop3Session, typename Stream>
+void pop3_session<Pop3Session, Stream>::start() {
+	set_stream_options( socket_ );
+	if( admission_ ) {
+		if( peer_.empty() )	peer_	=	peer_address( socket_ );
+		admission_result	result	=	admission_->admit_connection( peer_ );
+		if( result != admission_accepted ) {
+			// not counted. so not released at destructor.
+			admission_.reset();
+			if( result == admission_busy )	send_quit_response( "-ERR [SYS/TEMP] too many connections, try later\r\n" );
+			else														send_quit_response( "-ERR [SYS/TEMP] too many connections from your address, try later\r\n" );
+			return;
+		}
+	}
 	session_type* parent	=	static_cast<session_type*>(this);
 	send_single_response( true, parent->get_connection_string() );
 }
 
 //! handling after "QUIT" command. (do quit)
-template <typename Pop3Session>
-void pop3_session<Pop3Session>::handle_quit( 
+/*!
+	@note timer is canceled. so session (and admitted connection) is released
+		now, not at idle timeout.
+*/
+template <typename Pop3Session, typename Stream>
+void pop3_session<Pop3Session, Stream>::handle_quit( 
 	const boost::system::error_code& error
 ) {
+	timer_.cancel();
 	socket_.close();
 }
 
 //! handling read completion.
-template <typename Pop3Session>
-void pop3_session<Pop3Session>::handle_read( 
+template <typename Pop3Session, typename Stream>
+void pop3_session<Pop3Session, Stream>::handle_read( 
 	const boost::system::error_code& error
 ) {
 	if( !error ) {
-		std::istream	request_stream( &request_ );
+		std::istream	request_stream( request_ );
 		std::string command;
 		getuntil( request_stream, command, "\r\n" );
+		if( request_->size() == 0 ) {
+			// no pipelined command. return buffer while this session waits.
+			request_pool().release( request_ );
+			request_	=	0;
+		}
+		if( discard_line_ ) {
+			// tail of too long command line. already answered.
+			discard_line_	=	false;
+			handle_wrote( error );
+			return;
+		}
 		parse_command( command );
+	} else if( error == boost::asio::error::not_found ) {
+		// request_ is full without CRLF. drop it, and skip rest of line.
+		request_pool().release( request_ );
+		request_	=	0;
+		if( discard_line_ ) {
+			handle_wrote( boost::system::error_code() );
+		} else {
+			discard_line_	=	true;
+			send_single_response( false, "command line too long" );
+		}
+	} else {
+		// disconnected by client. release session (and admitted connection) now, not at timeout.
+		request_pool().release( request_ );
+		request_	=	0;
+		timer_.cancel();
 	}
 }
 
 //! parse "pop3 command" and call command.
-template <typename Pop3Session>
-void pop3_session<Pop3Session>::parse_command( 
+template <typename Pop3Session, typename Stream>
+void pop3_session<Pop3Session, Stream>::parse_command( 
 	const std::string& command	//!< [in] command line input
 ) {
 	//std::cout << command;
-	pop3_command_grammar<char const*>	pcg( state_ );
-	boost::spirit::classic::parse_info<> info	=	boost::spirit::classic::parse( command.c_str(), pcg );
+	// grammar is built once per thread and state flags. (not per command)
+	static boost::thread_specific_ptr<pop3_command_parser>	parser;
+	if( !parser.get() )	parser.reset( new pop3_command_parser() );
+	parser->parse( command, state_ );
 	session_type* parent	=	static_cast<session_type*>(this);
+	// command cost. charged to account in transaction, otherwise to client address.
+	if( admission_ && !admission_->admit_command( peer_, state_.in_transaction() ? user_account_ : std::string(), state_.cmd_type_ ) ) {
+		send_single_response( false, "[SYS/TEMP] too many commands, slow down" );
+		return;
+	}
 	// parse command
 	switch( state_.cmd_type_ ) {
 	case pop3_cmd_user:	parent->response_user( state_.arg<std::string>() );	break;
-	case pop3_cmd_pass:	parent->response_pass( user_account_, state_.arg<std::string>() );	break;
+	case pop3_cmd_pass: {
+		// login is charged after password check. (see admission_control)
+		std::string	user	=	user_account_;
+		if( admission_ && !admission_->admit_user( user ) ) {
+			state_.invalidate_user();
+			send_single_response( false, "[IN-USE] too many logins, try later" );
+			break;
+		}
+		parent->response_pass( user, state_.arg<std::string>() );
+		if( admission_ )	admission_->charge_login( peer_, user, state_.in_transaction() );
+		break;
+											}
 	case pop3_cmd_noop:	parent->response_noop();	break;
 	case pop3_cmd_rset:	parent->response_rset();	break;
 	case pop3_cmd_stat:	parent->response_stat();	break;
@@ -79,9 +193,23 @@ void pop3_session<Pop3Session>::parse_command(
 		else												parent->response_uidl( state_.arg<unsigned>() );
 		break;
 											}
-	case pop3_cmd_apop:	parent->response_apop( state_.arg<std::string>(), state_.arg<std::string>() );	break;
+	case pop3_cmd_apop: {
+		// arguments are queued FIFO. evaluation order of function arguments is unspecified.
+		std::string	user	=	state_.arg<std::string>();
+		if( admission_ && !admission_->admit_user( user ) ) {
+			send_single_response( false, "[IN-USE] too many logins, try later" );
+			break;
+		}
+		parent->response_apop( user, state_.arg<std::string>() );
+		if( admission_ )	admission_->charge_login( peer_, user, state_.in_transaction() );
+		break;
+											}
 	case pop3_cmd_dele:	parent->response_dele( state_.arg<unsigned>() );	break;
-	case pop3_cmd_top:	parent->response_top( state_.arg<unsigned>(), state_.arg<unsigned>() );		break;
+	case pop3_cmd_top: {
+		unsigned	tnum	=	state_.arg<unsigned>();
+		parent->response_top( tnum, state_.arg<unsigned>() );
+		break;
+											}
 	case pop3_cmd_retr:	parent->response_retr( state_.arg<unsigned>() );	break;
 	case pop3_cmd_quit:	parent->response_quit();	break;
 	default: {
@@ -93,14 +221,14 @@ void pop3_session<Pop3Session>::parse_command(
 }
 
 //! return pop3 server connection string
-template <typename Pop3Session>
-const std::string pop3_session<Pop3Session>::get_connection_string() {
+template <typename Pop3Session, typename Stream>
+const std::string pop3_session<Pop3Session, Stream>::get_connection_string() {
 	return std::string( "Hello Pop3 Client" );
 }
 
 //! do USER command
-template <typename Pop3Session>
-void pop3_session<Pop3Session>::response_user(
+template <typename Pop3Session, typename Stream>
+void pop3_session<Pop3Session, Stream>::response_user(
 	const std::string& user	//!< [in] mail accout (user) name
 ) {
 	// later check user and password. now validate user input by temporary
@@ -109,8 +237,8 @@ void pop3_session<Pop3Session>::response_user(
 }
 
 //! do PASS command
-template <typename Pop3Session>
-void pop3_session<Pop3Session>::response_pass(
+template <typename Pop3Session, typename Stream>
+void pop3_session<Pop3Session, Stream>::response_pass(
 	const std::string& user,	//!< [in] mail account (user) name
 	const std::string& pass		//!< [in] mail account (user) password
 ) {
@@ -118,8 +246,8 @@ void pop3_session<Pop3Session>::response_pass(
 }
 
 //! do APOP command
-template <typename Pop3Session>
-void pop3_session<Pop3Session>::response_apop(
+template <typename Pop3Session, typename Stream>
+void pop3_session<Pop3Session, Stream>::response_apop(
 	const std::string& user, 
 	const std::string& digest
 ) {
@@ -127,68 +255,68 @@ void pop3_session<Pop3Session>::response_apop(
 }
 
 //! do STAT command
-template <typename Pop3Session>
-void pop3_session<Pop3Session>::response_stat() {
+template <typename Pop3Session, typename Stream>
+void pop3_session<Pop3Session, Stream>::response_stat() {
 	BOOST_ASSERT( !"no implementation in Pop3Session" );
 }
 
 //! do LIST command
-template <typename Pop3Session>
-void pop3_session<Pop3Session>::response_list(
+template <typename Pop3Session, typename Stream>
+void pop3_session<Pop3Session, Stream>::response_list(
 	unsigned number
 ) {
 	BOOST_ASSERT( !"no implementation in Pop3Session" );
 }
 
 //! do LIST command
-template <typename Pop3Session>
-void pop3_session<Pop3Session>::response_list() {
+template <typename Pop3Session, typename Stream>
+void pop3_session<Pop3Session, Stream>::response_list() {
 	BOOST_ASSERT( !"no implementation in Pop3Session" );
 }
 
 //! do QUIT command
-template <typename Pop3Session>
-void pop3_session<Pop3Session>::response_quit() {
-	std::ostream	response_stream( &response_ );
+template <typename Pop3Session, typename Stream>
+void pop3_session<Pop3Session, Stream>::response_quit() {
+	std::ostream	response_stream( &response_buffer() );
 	response_stream << "+OK good bye\r\n";
 	boost::asio::async_write(
-		socket_, response_,
-		boost::bind( &session_type::handle_quit, shared_from_this(), boost::asio::placeholders::error )
+		socket_, *response_,
+		boost::bind( &session_type::handle_quit, this->shared_from_this(), boost::asio::placeholders::error )
 	);
 }
 
 //! do RETR command
-template <typename Pop3Session>
-void pop3_session<Pop3Session>::response_retr( 
+template <typename Pop3Session, typename Stream>
+void pop3_session<Pop3Session, Stream>::response_retr( 
 	unsigned rnum 
 ) {
 	BOOST_ASSERT( !"no implementation in Pop3Session" );
 }
 
 //! do DELE command
-template <typename Pop3Session>
-void pop3_session<Pop3Session>::response_dele( 
+template <typename Pop3Session, typename Stream>
+void pop3_session<Pop3Session, Stream>::response_dele( 
 	unsigned dnum 
 ) {
 	BOOST_ASSERT( !"no implementation in Pop3Session" );
 }
 
 //! do NOOP command
-template <typename Pop3Session>
-void pop3_session<Pop3Session>::response_noop() {
+template <typename Pop3Session, typename Stream>
+void pop3_session<Pop3Session, Stream>::response_noop() {
 	// automatically resets for each coomand
 	send_single_response( true, "reset auto disconnect timer" );
 }
 
 //! do RSET command
-template <typename Pop3Session>
-void pop3_session<Pop3Session>::response_rset() {
+template <typename Pop3Session, typename Stream>
+void pop3_session<Pop3Session, Stream>::response_rset() {
 	BOOST_ASSERT( !"no implementation in Pop3Session" );
 }
 
 //! do TOP command
-template <typename Pop3Session>
-void pop3_session<Pop3Session>::response_top( 
+template <typename Pop3Session, typename Stream>
+void pop3_session<Pop3Session, Stream>::response_top( 
 	unsigned tnum, 
 	unsigned wnum 
 ) {
@@ -196,63 +324,157 @@ void pop3_session<Pop3Session>::response_top(
 }
 
 //! do UIDL command
-template <typename Pop3Session>
-void pop3_session<Pop3Session>::response_uidl( 
+template <typename Pop3Session, typename Stream>
+void pop3_session<Pop3Session, Stream>::response_uidl( 
 	unsigned unum 
 ) {
 	BOOST_ASSERT( !"no implementation in Pop3Session" );
 }
 
 //! do UIDL command
-template <typename Pop3Session>
-void pop3_session<Pop3Session>::response_uidl() {
+template <typename Pop3Session, typename Stream>
+void pop3_session<Pop3Session, Stream>::response_uidl() {
 	BOOST_ASSERT( !"no implementation in Pop3Session" );
 }
 
-//! get boost::asio::stream_socket
+//! resource limits of this session type
+/*!
+	@attention change limits before server starts. limits are not locked.
+	@retval shared limits
+*/
+template <typename Pop3Session, typename Stream>
+pop3_limits& pop3_session<Pop3Session, Stream>::limits() {
+	static pop3_limits	instance;
+	return instance;
+}
+
+//! pool of command line buffers of this session type
+/*!
+	@note each buffer is limited to limits().max_command_line_.
+	@retval shared pool
+*/
+template <typename Pop3Session, typename Stream>
+buffer_pool& pop3_session<Pop3Session, Stream>::request_pool() {
+	static buffer_pool	instance( limits().max_command_line_, limits().max_pooled_buffers_, limits().max_pooled_capacity_ );
+	return instance;
+}
+
+//! pool of response buffers of this session type
+/*!
+	@note size of response is checked by limits().max_response_ before write.
+	@retval shared pool
+*/
+template <typename Pop3Session, typename Stream>
+buffer_pool& pop3_session<Pop3Session, Stream>::response_pool() {
+	static buffer_pool	instance( (std::numeric_limits<std::size_t>::max)(), limits().max_pooled_buffers_, limits().max_pooled_capacity_ );
+	return instance;
+}
+
+//! get stream of session
 /*!
-	@retval this session socket
+	@retval this session stream (socket)
 */
-template <typename Pop3Session>
-boost::asio::ip::tcp::socket& pop3_session<Pop3Session>::socket() { 
+template <typename Pop3Session, typename Stream>
+Stream& pop3_session<Pop3Session, Stream>::socket() { 
 	return socket_; 
 }
 
 //! send single line response.
-template <typename Pop3Session>
-void pop3_session<Pop3Session>::send_single_response( 
+template <typename Pop3Session, typename Stream>
+void pop3_session<Pop3Session, Stream>::send_single_response( 
 	bool success,	//!< [in] command result status. true: +OK, false: -ERR
 	const std::string& msg	//!< [in] additional information
 ) {
-	std::ostream	response_stream( &response_ );
-	if( success )	response_stream << "+OK";
-	else					response_stream << "-ERR";
-	response_stream << " " << msg << "\r\n";
+	std::ostream	response_stream( &response_buffer() );
+	if( limits().max_response_ < msg.size() ) {
+		// multi line response built in memory is too large. (use send_listing_response for LIST)
+		response_stream << "-ERR [SYS/TEMP] response too large\r\n";
+	} else {
+		if( success )	response_stream << "+OK";
+		else					response_stream << "-ERR";
+		response_stream << " " << msg << "\r\n";
+	}
 	boost::asio::async_write( 
-		socket_, response_,
-		boost::bind( &session_type::handle_wrote, shared_from_this(), boost::asio::placeholders::error )
+		socket_, *response_,
+		boost::bind( &session_type::handle_wrote, this->shared_from_this(), boost::asio::placeholders::error )
 	);
 	reset_timer();
 }
 
+//! send multi line listing response in chunks. (for LIST, UIDL)
+/*!
+	@note lines are written by Pop3Session::listing_line() in chunks up to
+		limits().low_watermark_. next chunk is built after previous chunk is
+		written, so listing of large maildrop never is built in memory at once,
+		and it waits for slow client.
+	@attention Pop3Session calls this instead of send_single_response.
+*/
+template <typename Pop3Session, typename Stream>
+void pop3_session<Pop3Session, Stream>::send_listing_response(
+	bool								uidl,		//!< [in] true: UIDL, false: LIST
+	const std::string&	msg,		//!< [in] additional information of +OK line
+	unsigned						count		//!< [in] number of messages (include deleted)
+) {
+	std::ostream	response_stream( &response_buffer() );
+	response_stream << "+OK " << msg << "\r\n";
+	write_listing( uidl, 1, count );
+}
+
+//! write next chunk of listing response.
+template <typename Pop3Session, typename Stream>
+void pop3_session<Pop3Session, Stream>::write_listing(
+	bool			uidl,		//!< [in] true: UIDL, false: LIST
+	unsigned	number,	//!< [in] first message number of this chunk
+	unsigned	count		//!< [in] number of messages (include deleted)
+) {
+	std::ostream	response_stream( &response_buffer() );
+	session_type*	parent	=	static_cast<session_type*>(this);
+	for( ; number <= count && response_->size() < limits().low_watermark_; ++number ) {
+		if( parent->listing_line( uidl, number, response_stream ) )	response_stream << "\r\n";
+	}
+	if( count < number )	response_stream << ".\r\n";
+	boost::asio::async_write(
+		socket_, *response_,
+		boost::bind( &session_type::handle_listing_wrote, this->shared_from_this(), uidl, number, count, boost::asio::placeholders::error )
+	);
+	reset_timer();
+}
+
+//! handling chunk write completion of listing response.
+template <typename Pop3Session, typename Stream>
+void pop3_session<Pop3Session, Stream>::handle_listing_wrote(
+	bool															uidl,
+	unsigned													number,
+	unsigned													count,
+	const boost::system::error_code&	error
+) {
+	if( error || count < number ) {
+		handle_wrote( error );
+		return;
+	}
+	write_listing( uidl, number, count );
+}
+
 //! write quit response line. next do is disconnect.
 /*!
 	@attention this is final response of quit. next do is disconnect.
 */
-template <typename Pop3Session>
-void pop3_session<Pop3Session>::send_quit_response( 
+template <typename Pop3Session, typename Stream>
+void pop3_session<Pop3Session, Stream>::send_quit_response( 
 	const std::string& response	//!< [in] command response
 ) {
+	std::ostream	response_stream( &response_buffer() );
+	response_stream << response;
 	boost::asio::async_write(
-		socket_, response_,
-		boost::bind( &session_type::handle_quit, shared_from_this(), boost::asio::placeholders::error )
+		socket_, *response_,
+		boost::bind( &session_type::handle_quit, this->shared_from_this(), boost::asio::placeholders::error )
 	);
 	reset_timer();
 }
 
 //! check session timeout and do.
-template <typename Pop3Session>
-void pop3_session<Pop3Session>::handle_expire(
+template <typename Pop3Session, typename Stream>
+void pop3_session<Pop3Session, Stream>::handle_expire(
 	const boost::system::error_code& error
 ) {
 	if( error != boost::asio::error::operation_aborted ) {
@@ -261,31 +483,247 @@ void pop3_session<Pop3Session>::handle_expire(
 }
 
 //! read client input. and reroute handle_command.
-template <typename Pop3Session>
-void pop3_session<Pop3Session>::handle_wrote(
+template <typename Pop3Session, typename Stream>
+void pop3_session<Pop3Session, Stream>::handle_wrote(
 	const boost::system::error_code&	error
 ) {
+	// response is written. return buffer while this session waits.
+	response_pool().release( response_ );
+	response_	=	0;
 	if( !error ) {
+		start_read();
+		reset_timer();
+	}
+}
+
+//! wait next command. (read buffer is not taken until data arrives)
+/*!
+	@note pipelined command left in request_ is read at once. otherwise
+		session waits readiness of stream with no buffer. (null_buffers)
+*/
+template <typename Pop3Session, typename Stream>
+void pop3_session<Pop3Session, Stream>::start_read() {
+	if( request_ ) {
 		boost::asio::async_read_until( 
-			socket_, request_, "\r\n",
+			socket_, *request_, "\r\n",
 			boost::bind(
-				&session_type::handle_read, shared_from_this(),
+				&session_type::handle_read, this->shared_from_this(),
 				boost::asio::placeholders::error
 			)
 		);
-		reset_timer();
+	} else {
+		socket_.async_read_some(
+			boost::asio::null_buffers(),
+			boost::bind(
+				&session_type::handle_ready, this->shared_from_this(),
+				boost::asio::placeholders::error
+			)
+		);
+	}
+}
+
+//! handling data arrival. take read buffer and read command line.
+template <typename Pop3Session, typename Stream>
+void pop3_session<Pop3Session, Stream>::handle_ready(
+	const boost::system::error_code&	error
+) {
+	if( error ) {
+		// disconnected by client. same as read error.
+		timer_.cancel();
+		return;
 	}
+	request_	=	request_pool().acquire();
+	start_read();
+}
+
+//! take response buffer from pool
+/*!
+	@retval response buffer. (kept until write completion)
+*/
+template <typename Pop3Session, typename Stream>
+boost::asio::streambuf& pop3_session<Pop3Session, Stream>::response_buffer() {
+	if( !response_ )	response_	=	response_pool().acquire();
+	return *response_;
 }
 
 //! reset timer count. and reserve timeout check (= handle_expire).
-template <typename Pop3Session>
-void pop3_session<Pop3Session>::reset_timer() {
+template <typename Pop3Session, typename Stream>
+void pop3_session<Pop3Session, Stream>::reset_timer() {
 	timer_.cancel();
-	timer_.expires_from_now(session_time_duration_);
+	timer_.expires_from_now(limits().idle_timeout_);
 	timer_.async_wait( 
-		boost::bind( &session_type::handle_expire, shared_from_this(), boost::asio::placeholders::error )
+		boost::bind( &session_type::handle_expire, this->shared_from_this(), boost::asio::placeholders::error )
 	);
 }
 
+//! charge octets of response to admission control.
+/*!
+	@note Pop3Session which writes response itself (e.g. mbox_session) calls this.
+*/
+template <typename Pop3Session, typename Stream>
+void pop3_session<Pop3Session, Stream>::charge_octets(
+	unsigned long	octets	//!< [in] response octets
+) {
+	if( admission_ )	admission_->charge_octets( peer_, state_.in_transaction() ? user_account_ : std::string(), octets );
+}
+
+//! send multi line response from file range. (for RETR, TOP)
+/*!
+	@note file is read by disk_io_executor, and dot-stuffed and terminated here.
+		next chunk is read while previous chunk is written.
+	@attention Pop3Session calls this instead of send_single_response.
+*/
+template <typename Pop3Session, typename Stream>
+void pop3_session<Pop3Session, Stream>::send_file_response(
+	disk_io_executor&		executor,	//!< [in] executor for disk reads
+	const std::string&	msg,			//!< [in] additional information of +OK line
+	const std::string&	path,			//!< [in] message file path
+	unsigned long				offset,		//!< [in] start position of message in file
+	unsigned long				length		//!< [in] length of message
+) {
+	boost::shared_ptr<file_transfer>	transfer( new file_transfer( executor, path, offset, length, read_ahead_size() ) );
+	charge_octets( length );
+	start_file_response( transfer, msg );
+}
+
+//! send multi line response from file range, with limited body lines. (for TOP)
+/*!
+	@note use this when end of TOP range is not known from index. if it is
+		known, send the range by send_file_response without line limit.
+*/
+template <typename Pop3Session, typename Stream>
+void pop3_session<Pop3Session, Stream>::send_file_response(
+	disk_io_executor&		executor,	//!< [in] executor for disk reads
+	const std::string&	msg,			//!< [in] additional information of +OK line
+	const std::string&	path,			//!< [in] message file path
+	unsigned long				offset,		//!< [in] start position of message in file
+	unsigned long				length,		//!< [in] length of message
+	unsigned long				body,			//!< [in] start position of body in file
+	unsigned long				lines			//!< [in] number of body lines to send
+) {
+	boost::shared_ptr<file_transfer>	transfer( new file_transfer( executor, path, offset, length, read_ahead_size() ) );
+	transfer->limit_lines( body, lines );
+	charge_octets( length );
+	start_file_response( transfer, msg );
+}
+
+//! start transfer. +OK line is written with first chunk.
+/*!
+	@note file is opened by first read on disk_io_executor before +OK line is
+		written. so message file which can not be read (e.g. removed by other
+		process) gets -ERR, not +OK and disconnect.
+*/
+template <typename Pop3Session, typename Stream>
+void pop3_session<Pop3Session, Stream>::start_file_response(
+	boost::shared_ptr<file_transfer>	transfer,
+	const std::string&								msg
+) {
+	transfer->head_.reset( new std::string( "+OK " + msg + "\r\n" ) );
+	start_file_read( transfer );
+	reset_timer();
+}
+
+//! read-ahead size of file response. (= socket send buffer size)
+template <typename Pop3Session, typename Stream>
+std::size_t pop3_session<Pop3Session, Stream>::read_ahead_size() {
+	boost::asio::socket_base::send_buffer_size	option;
+	boost::system::error_code	error;
+	socket_.get_option( option, error );
+	if( error || option.value() <= 0 )	return 65536;
+	return static_cast<std::size_t>( option.value() );
+}
+
+//! read next chunk of file response.
+template <typename Pop3Session, typename Stream>
+void pop3_session<Pop3Session, Stream>::start_file_read(
+	boost::shared_ptr<file_transfer>	transfer
+) {
+	// first read opens file. even if range is empty.
+	if( transfer->reading_ || transfer->pending_ || ( transfer->remain_ == 0 && !transfer->head_ ) )	return;
+	// chunk is at most low watermark. so next chunk is read while one chunk is
+	// written. read ahead stops above high watermark, and resumes at next write completion.
+	std::size_t	length	=	static_cast<std::size_t>( std::min<unsigned long>(
+		std::min( transfer->chunk_, limits().low_watermark_ ), transfer->remain_
+	) );
+	if( limits().high_watermark_ < transfer->outstanding_ + length )	return;
+	transfer->reading_	=	true;
+	transfer->executor_.async_read(
+		io_service_, transfer->stream_, transfer->path_, transfer->offset_, length,
+		boost::bind( &session_type::handle_file_read, this->shared_from_this(), transfer, _1, _2 )
+	);
+}
+
+//! write chunk of file response.
+/*!
+	@note read-ahead of next chunk starts with this write.
+*/
+template <typename Pop3Session, typename Stream>
+void pop3_session<Pop3Session, Stream>::start_file_write(
+	boost::shared_ptr<file_transfer>	transfer,
+	boost::shared_ptr<std::string>		chunk
+) {
+	transfer->writing_	=	true;
+	boost::asio::async_write(
+		socket_, boost::asio::buffer( *chunk ),
+		boost::bind( &session_type::handle_file_wrote, this->shared_from_this(), transfer, chunk, boost::asio::placeholders::error )
+	);
+	start_file_read( transfer );
+}
+
+//! handling chunk read completion of file response.
+template <typename Pop3Session, typename Stream>
+void pop3_session<Pop3Session, Stream>::handle_file_read(
+	boost::shared_ptr<file_transfer>	transfer,
+	const boost::system::error_code&	error,
+	disk_io_executor::buffer_ptr			data
+) {
+	transfer->reading_	=	false;
+	if( error == boost::asio::error::eof ) {
+		// file is shorter than requested range. end response here.
+		transfer->remain_	=	0;
+	} else if( error ) {
+		if( transfer->head_ ) {
+			// first read. nothing is sent yet.
+			send_single_response( false, "no such message" );
+			return;
+		}
+		// +OK is already sent. so no way to report error but disconnect.
+		socket_.close();
+		return;
+	}
+	transfer->offset_	+=	data->size();
+	transfer->remain_	-=	std::min<unsigned long>( data->size(), transfer->remain_ );
+	boost::shared_ptr<std::string>	chunk;
+	chunk.swap( transfer->head_ );
+	if( !chunk )	chunk.reset( new std::string() );
+	transfer->stuff( *data, *chunk );
+	if( transfer->remain_ == 0 )	transfer->terminate( *chunk );
+	transfer->outstanding_	+=	chunk->size();
+	if( transfer->writing_ )	transfer->pending_	=	chunk;
+	else											start_file_write( transfer, chunk );
+}
+
+//! handling chunk write completion of file response.
+template <typename Pop3Session, typename Stream>
+void pop3_session<Pop3Session, Stream>::handle_file_wrote(
+	boost::shared_ptr<file_transfer>	transfer,
+	boost::shared_ptr<std::string>		chunk,
+	const boost::system::error_code&	error
+) {
+	transfer->writing_	=	false;
+	transfer->outstanding_	-=	std::min( chunk->size(), transfer->outstanding_ );
+	if( error )	return;
+	reset_timer();
+	if( transfer->pending_ ) {
+		boost::shared_ptr<std::string>	chunk	=	transfer->pending_;
+		transfer->pending_.reset();
+		start_file_write( transfer, chunk );
+	} else if( transfer->done() ) {
+		handle_wrote( error );
+	} else {
+		start_file_read( transfer );
+	}
+}
+
 //}	// namespace pop3
 //}	// namespace rfc
@@ -0,0 +1,141 @@
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+# pragma once
+#endif // defined(_MSC_VER) && (_MSC_VER >= 1200)
+#ifndef POP3STREAM_HPP
+#define POP3STREAM_HPP
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+//
+// Copyright (c) 2006-2009 OKI Miyuki (oki.miyuki at gmail dot com)
+//
+#include <string>
+#include <boost/asio.hpp>
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/version.hpp>
+
+namespace rfc {
+namespace pop3 {
+
+//@{
+/*!
+  stream and acceptor types of pop3_session and pop3_server.
+  @li TCP: boost::asio::ip::tcp::socket, boost::asio::ip::tcp::acceptor (default)
+  @li Unix domain socket: local_stream, local_acceptor
+  @li in memory: memory_stream (no acceptor. connect() streams directly)
+*/
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+typedef boost::asio::local::stream_protocol::socket    local_stream;
+typedef boost::asio::local::stream_protocol::acceptor  local_acceptor;
+#endif  // defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+//@}
+
+//! one direction of memory_stream
+struct memory_channel : private boost::noncopyable {
+  boost::mutex              mutex_;
+  std::string               data_;    //!< written and not yet read
+  bool                      closed_;  //!< no more data. (either end is closed)
+  boost::function<void()>   reader_;  //!< read waiting for data
+
+  //! constructor
+  memory_channel();
+};
+
+//! in memory duplex stream
+/*!
+  @note Two memory_streams are connected by connect(), and each write is read
+    by the other end. It is AsyncReadStream and AsyncWriteStream, so sessions
+    run over it without sockets and syscalls. (e.g. benchmark of parser and
+    session state machine)
+  @note Read waits until data is available or stream is closed. so zero
+    length read (e.g. boost::asio::null_buffers) completes when data is
+    available, same as readiness wait of socket.
+  @attention handlers are posted to io_service of each end.
+*/
+class memory_stream : private boost::noncopyable {
+public:
+  typedef memory_stream  lowest_layer_type;
+#if BOOST_VERSION >= 106600
+  typedef boost::asio::io_context::executor_type  executor_type;
+#endif  // BOOST_VERSION >= 106600
+
+  //! constructor
+  explicit memory_stream( boost::asio::io_service& );
+  //! destructor. close stream.
+  ~memory_stream();
+
+  //! get io_service
+  boost::asio::io_service& get_io_service();
+#if BOOST_VERSION >= 106600
+  //! get executor
+  executor_type get_executor();
+#endif  // BOOST_VERSION >= 106600
+  //! get lowest layer
+  lowest_layer_type& lowest_layer();
+
+  //! connect with other end
+  void connect( memory_stream& );
+  //! inspect stream is open
+  bool is_open() const;
+  //! close stream. the other end reads eof.
+  void close();
+  //! close stream. the other end reads eof.
+  boost::system::error_code close( boost::system::error_code& );
+  //! get socket option. (not supported)
+  template <typename Option>
+  boost::system::error_code get_option( Option&, boost::system::error_code& ) const;
+
+  //! start asynchronous read
+  template <typename MutableBufferSequence, typename ReadHandler>
+  void async_read_some( const MutableBufferSequence&, ReadHandler );
+  //! start asynchronous write
+  template <typename ConstBufferSequence, typename WriteHandler>
+  void async_write_some( const ConstBufferSequence&, WriteHandler );
+  //! write. (never blocks)
+  template <typename ConstBufferSequence>
+  std::size_t write_some( const ConstBufferSequence&, boost::system::error_code& );
+
+private:
+  //! read operation waiting for data
+  template <typename MutableBufferSequence, typename ReadHandler>
+  struct read_op {
+    boost::asio::io_service&            io_service_;
+    boost::shared_ptr<memory_channel>   channel_;
+    MutableBufferSequence               buffers_;
+    ReadHandler                         handler_;
+
+    read_op( boost::asio::io_service&, boost::shared_ptr<memory_channel>, const MutableBufferSequence&, ReadHandler );
+    void operator()();
+  };
+
+  //! wake read waiting on channel
+  static void notify( memory_channel& );
+
+private:
+  boost::asio::io_service&            io_service_;
+  boost::shared_ptr<memory_channel>   in_;    //!< written by other end
+  boost::shared_ptr<memory_channel>   out_;   //!< read by other end
+};
+
+//! client address of stream. (key of admission control)
+std::string peer_address( boost::asio::ip::tcp::socket& );
+//! client address of stream. (key of admission control)
+template <typename Stream>
+std::string peer_address( Stream& );
+//! set options of accepted stream
+void set_stream_options( boost::asio::ip::tcp::socket& );
+//! set options of accepted stream
+template <typename Stream>
+void set_stream_options( Stream& );
+
+#include <pop3stream.ipp>
+
+}  // namespace pop3
+}  // namespace rfc
+
+#endif  // POP3STREAM_HPP
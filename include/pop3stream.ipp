@@ -0,0 +1,273 @@
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+//
+// Copyright (c) 2006-2009 OKI Miyuki (oki.miyuki at gmail dot com)
+//
+
+//namespace rfc {
+//namespace pop3 {
+
+//! constructor
+inline memory_channel::memory_channel() :
+  mutex_(),
+  data_(),
+  closed_( false ),
+  reader_()
+{
+}
+
+//! constructor
+inline memory_stream::memory_stream(
+  boost::asio::io_service& io_service //!< [in] io_service of handlers
+) :
+  io_service_( io_service ),
+  in_(),
+  out_()
+{
+}
+
+//! destructor. close stream.
+inline memory_stream::~memory_stream() {
+  close();
+}
+
+//! get io_service
+inline boost::asio::io_service& memory_stream::get_io_service() {
+  return io_service_;
+}
+
+#if BOOST_VERSION >= 106600
+//! get executor
+inline memory_stream::executor_type memory_stream::get_executor() {
+  return io_service_.get_executor();
+}
+#endif  // BOOST_VERSION >= 106600
+
+//! get lowest layer
+inline memory_stream::lowest_layer_type& memory_stream::lowest_layer() {
+  return *this;
+}
+
+//! connect with other end
+inline void memory_stream::connect(
+  memory_stream& peer //!< [in,out] other end
+) {
+  BOOST_ASSERT( !is_open() && !peer.is_open() );
+  in_.reset( new memory_channel() );
+  out_.reset( new memory_channel() );
+  peer.in_   =  out_;
+  peer.out_  =  in_;
+}
+
+//! inspect stream is open
+inline bool memory_stream::is_open() const {
+  return in_.get() != 0;
+}
+
+//! close stream. the other end reads eof.
+inline void memory_stream::close() {
+  boost::system::error_code  error;
+  close( error );
+}
+
+//! close stream. the other end reads eof.
+/*!
+  @note read waiting on this end completes with eof too.
+*/
+inline boost::system::error_code memory_stream::close(
+  boost::system::error_code& error  //!< [out] always success
+) {
+  error  =  boost::system::error_code();
+  if( !is_open() )  return error;
+  {
+    boost::mutex::scoped_lock  lock( out_->mutex_ );
+    out_->closed_  =  true;
+  }
+  {
+    boost::mutex::scoped_lock  lock( in_->mutex_ );
+    in_->closed_  =  true;
+  }
+  notify( *out_ );
+  notify( *in_ );
+  in_.reset();
+  out_.reset();
+  return error;
+}
+
+//! get socket option. (not supported)
+/*!
+  @note caller falls back to default. (e.g. pop3_session::read_ahead_size)
+*/
+template <typename Option>
+boost::system::error_code memory_stream::get_option(
+  Option&,
+  boost::system::error_code& error  //!< [out] operation_not_supported
+) const {
+  error  =  boost::asio::error::operation_not_supported;
+  return error;
+}
+
+//! start asynchronous read
+/*!
+  @note handler( const boost::system::error_code&, std::size_t ) is called
+    when data is available or stream is closed. (eof)
+*/
+template <typename MutableBufferSequence, typename ReadHandler>
+void memory_stream::async_read_some(
+  const MutableBufferSequence&  buffers,  //!< [in] buffers to read
+  ReadHandler                   handler   //!< [in] completion handler
+) {
+  if( !is_open() ) {
+    io_service_.post( boost::bind<void>( handler, boost::asio::error::bad_descriptor, 0 ) );
+    return;
+  }
+  read_op<MutableBufferSequence, ReadHandler>  op( io_service_, in_, buffers, handler );
+  {
+    boost::mutex::scoped_lock  lock( in_->mutex_ );
+    BOOST_ASSERT( !in_->reader_ );
+    if( in_->data_.empty() && !in_->closed_ ) {
+      in_->reader_  =  op;
+      return;
+    }
+  }
+  op();
+}
+
+//! start asynchronous write
+/*!
+  @note write never waits. all data is written at once.
+*/
+template <typename ConstBufferSequence, typename WriteHandler>
+void memory_stream::async_write_some(
+  const ConstBufferSequence&  buffers,  //!< [in] buffers to write
+  WriteHandler                handler   //!< [in] completion handler
+) {
+  boost::system::error_code  error;
+  std::size_t  length  =  write_some( buffers, error );
+  io_service_.post( boost::bind<void>( handler, error, length ) );
+}
+
+//! write. (never blocks)
+template <typename ConstBufferSequence>
+std::size_t memory_stream::write_some(
+  const ConstBufferSequence&    buffers,  //!< [in] buffers to write
+  boost::system::error_code&    error     //!< [out] broken_pipe if other end is closed
+) {
+  if( !is_open() ) {
+    error  =  boost::asio::error::bad_descriptor;
+    return 0;
+  }
+  std::size_t  length  =  boost::asio::buffer_size( buffers );
+  {
+    boost::mutex::scoped_lock  lock( out_->mutex_ );
+    if( out_->closed_ ) {
+      error  =  boost::asio::error::broken_pipe;
+      return 0;
+    }
+    std::size_t  size  =  out_->data_.size();
+    out_->data_.resize( size + length );
+    if( 0 < length )  boost::asio::buffer_copy( boost::asio::buffer( &out_->data_[ size ], length ), buffers );
+  }
+  error  =  boost::system::error_code();
+  notify( *out_ );
+  return length;
+}
+
+//! wake read waiting on channel
+inline void memory_stream::notify(
+  memory_channel& channel //!< [in,out] channel
+) {
+  boost::function<void()>  reader;
+  {
+    boost::mutex::scoped_lock  lock( channel.mutex_ );
+    reader.swap( channel.reader_ );
+  }
+  if( reader )  reader();
+}
+
+//! constructor
+template <typename MutableBufferSequence, typename ReadHandler>
+memory_stream::read_op<MutableBufferSequence, ReadHandler>::read_op(
+  boost::asio::io_service&            io_service,
+  boost::shared_ptr<memory_channel>   channel,
+  const MutableBufferSequence&        buffers,
+  ReadHandler                         handler
+) :
+  io_service_( io_service ),
+  channel_( channel ),
+  buffers_( buffers ),
+  handler_( handler )
+{
+}
+
+//! copy available data. and post handler.
+template <typename MutableBufferSequence, typename ReadHandler>
+void memory_stream::read_op<MutableBufferSequence, ReadHandler>::operator()() {
+  boost::system::error_code  error;
+  std::size_t  length  =  0;
+  {
+    boost::mutex::scoped_lock  lock( channel_->mutex_ );
+    if( channel_->data_.empty() ) {
+      error  =  boost::asio::error::eof;
+    } else {
+      length  =  boost::asio::buffer_copy( buffers_, boost::asio::buffer( channel_->data_ ) );
+      channel_->data_.erase( 0, length );
+    }
+  }
+  io_service_.post( boost::bind<void>( handler_, error, length ) );
+}
+
+//! client address of stream. (key of admission control)
+/*!
+  @retval IP address of TCP client. empty if not connected.
+*/
+inline std::string peer_address(
+  boost::asio::ip::tcp::socket& socket  //!< [in] connected socket
+) {
+  boost::system::error_code  error;
+  boost::asio::ip::tcp::endpoint  endpoint  =  socket.remote_endpoint( error );
+  if( error )  return std::string();
+  return endpoint.address().to_string();
+}
+
+//! client address of stream. (key of admission control)
+/*!
+  @note Unix domain socket and memory_stream have no client address. they
+    are not limited per IP address, unless acceptor (e.g. local proxy) sets
+    client address by pop3_session::peer().
+  @retval empty
+*/
+template <typename Stream>
+std::string peer_address(
+  Stream&
+) {
+  return std::string();
+}
+
+//! set options of accepted stream
+/*!
+  @note multi line responses are written in several writes. with Nagle
+    algorithm, last short segment of response waits delayed ACK of client.
+    so Nagle algorithm is disabled.
+*/
+inline void set_stream_options(
+  boost::asio::ip::tcp::socket& socket  //!< [in,out] connected socket
+) {
+  boost::system::error_code  error;
+  socket.set_option( boost::asio::ip::tcp::no_delay( true ), error );
+}
+
+//! set options of accepted stream
+/*!
+  @note nothing to set for Unix domain socket and memory_stream.
+*/
+template <typename Stream>
+void set_stream_options(
+  Stream&
+) {
+}
+
+//}  // namespace pop3
+//}  // namespace rfc
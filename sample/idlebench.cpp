@@ -0,0 +1,133 @@
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+//
+// Copyright (c) 2006-2009 OKI Miyuki (oki.miyuki at gmail dot com)
+//
+//---------------------------------------------------------------------------
+// per-session memory of idle connections
+//   idlebench [connections]
+//   prints size of pop3_session members, and resident memory of idle
+//   sessions over memory_stream. memory of stream pairs is measured first,
+//   and subtracted from memory of sessions.
+//---------------------------------------------------------------------------
+#define WIN32_LEAN_AND_MEAN
+#include <pop3server.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <iostream>
+
+using namespace rfc::pop3;
+
+//! idle session. (only greeting is sent)
+class idle_session :
+  public pop3_session< idle_session, memory_stream >
+{
+public:
+  typedef pop3_session< idle_session, memory_stream >  base_type;
+
+  //! constructor
+  idle_session( boost::asio::io_service& io_service ) : base_type( io_service ) {}
+
+  void response_pass( const std::string&, const std::string& ) {}
+  void response_stat()              {}
+  void response_list( unsigned )    {}
+  void response_list()              {}
+  void response_retr( unsigned )    {}
+  void response_dele( unsigned )    {}
+  void response_rset()              {}
+  void response_top( unsigned, unsigned ) {}
+  void response_uidl( unsigned )    {}
+  void response_uidl()              {}
+
+  //! print size of members
+  static void report_layout() {
+    std::cout << "sizeof(pop3_session)        " << sizeof( base_type ) << "\n"
+      << "  pop3_state                 " << sizeof( pop3_state ) << "\n"
+      << "  memory_stream              " << sizeof( memory_stream ) << "\n"
+      << "  boost::asio::deadline_timer " << sizeof( boost::asio::deadline_timer ) << "\n"
+      << "  std::string (x2)           " << sizeof( std::string ) << "\n"
+      << "  buffer pointer (x2)        " << sizeof( buffer_pool::buffer_type* ) << "\n"
+      << "  boost::asio::streambuf (pooled, not in session) " << sizeof( boost::asio::streambuf ) << std::endl;
+  }
+};
+
+namespace {
+  //! resident memory of this process (bytes). 0 if unknown.
+  std::size_t resident_size() {
+    std::size_t  pages  =  0;
+    std::size_t  resident  =  0;
+    std::FILE*  fp  =  std::fopen( "/proc/self/statm", "r" );
+    if( !fp )  return 0;
+    if( std::fscanf( fp, "%lu %lu", &pages, &resident ) != 2 )  resident  =  0;
+    std::fclose( fp );
+    return resident * 4096;
+  }
+
+  //! print memory per connection
+  void report( const char* name, std::size_t before, std::size_t after, unsigned count ) {
+    if( before == 0 || after == 0 ) {
+      std::cout << name << ": resident memory is not available" << std::endl;
+      return;
+    }
+    std::cout << name << ": " << ( after - before ) / ( 1024 * 1024 ) << " MB, "
+      << ( after - before ) / count << " bytes/connection" << std::endl;
+  }
+}
+
+int main( int argc, char* argv[] ) {
+  unsigned  count  =  ( 1 < argc ) ? std::atoi( argv[1] ) : 100000;
+  idle_session::report_layout();
+
+  std::size_t  streams  =  0;
+  // stream pairs only. (with greeting in channel)
+  {
+    boost::asio::io_service  io_service;
+    std::vector< boost::shared_ptr<memory_stream> >  ends;
+    ends.reserve( count * 2 );
+    std::size_t  before  =  resident_size();
+    for( unsigned i = 0; i < count; ++i ) {
+      boost::shared_ptr<memory_stream>  server( new memory_stream( io_service ) );
+      boost::shared_ptr<memory_stream>  client( new memory_stream( io_service ) );
+      server->connect( *client );
+      boost::system::error_code  error;
+      server->write_some( boost::asio::buffer( std::string( "+OK Hello Pop3 Client\r\n" ) ), error );
+      ends.push_back( server );
+      ends.push_back( client );
+    }
+    std::size_t  after  =  resident_size();
+    report( "memory_stream pairs", before, after, count );
+    streams  =  ( before != 0 && after != 0 ) ? after - before : 0;
+  }
+
+  // idle sessions. greeting is sent, and each session waits next command.
+  {
+    boost::asio::io_service  io_service;
+    std::vector< boost::shared_ptr<idle_session> >  sessions;
+    std::vector< boost::shared_ptr<memory_stream> >  clients;
+    sessions.reserve( count );
+    clients.reserve( count );
+    std::size_t  before  =  resident_size();
+    for( unsigned i = 0; i < count; ++i ) {
+      boost::shared_ptr<idle_session>  session( new idle_session( io_service ) );
+      boost::shared_ptr<memory_stream>  client( new memory_stream( io_service ) );
+      session->socket().connect( *client );
+      session->start();
+      sessions.push_back( session );
+      clients.push_back( client );
+    }
+    io_service.poll();
+    std::size_t  after  =  resident_size();
+    report( "idle sessions      ", before, after, count );
+    if( streams != 0 && after != 0 && streams < after - before ) {
+      std::cout << "session only       : " << ( after - before - streams ) / count << " bytes/connection" << std::endl;
+    }
+    std::cout << "pooled buffers     : " << idle_session::request_pool().pooled()
+      << " request, " << idle_session::response_pool().pooled() << " response" << std::endl;
+    // sessions are closed here. timers are canceled by close of io_service.
+    for( unsigned i = 0; i < count; ++i )  clients[i]->close();
+  }
+  return 0;
+}
@@ -0,0 +1,99 @@
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+//
+// Copyright (c) 2006-2009 OKI Miyuki (oki.miyuki at gmail dot com)
+//
+//---------------------------------------------------------------------------
+// benchmark of pop3maildrop.hpp
+//   maildropbench [directory] [sessions] [messages]
+//   many sessions attach same maildrop, DELE own messages and commit.
+//   message of UIDL n belongs to session (n % sessions). message numbers
+//   differ between snapshots, so ownership is decided by UIDL.
+//---------------------------------------------------------------------------
+#include <pop3maildrop.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+using namespace rfc::pop3;
+
+namespace {
+  boost::mutex  stat_mutex;
+  double        attach_total  =  0.0;
+  double        commit_total  =  0.0;
+  double        commit_max    =  0.0;
+  std::size_t   removed_total =  0;
+  unsigned      failed_total  =  0;
+}
+
+//! one session: attach, delete every message of own slot (by UIDL), commit.
+void run_session( maildrop_registry* registry, std::string directory, unsigned slot, unsigned sessions ) {
+  using boost::posix_time::microsec_clock;
+  maildrop_view  view;
+  boost::posix_time::ptime  t0  =  microsec_clock::universal_time();
+  view.attach( registry->open( directory ) );
+  boost::posix_time::ptime  t1  =  microsec_clock::universal_time();
+  for( unsigned i = 1; i <= view.size(); ++i ) {
+    if( std::strtoul( view.message( i ).uidl_.c_str(), 0, 10 ) % sessions == slot )  view.dele( i );
+  }
+  boost::posix_time::ptime  t2  =  microsec_clock::universal_time();
+  unsigned  marked     =  view.size() - view.count();
+  bool      committed  =  view.commit();
+  boost::posix_time::ptime  t3  =  microsec_clock::universal_time();
+
+  boost::mutex::scoped_lock  lock( stat_mutex );
+  double  commit_us  =  static_cast<double>( (t3 - t2).total_microseconds() );
+  attach_total   +=  static_cast<double>( (t1 - t0).total_microseconds() );
+  commit_total   +=  commit_us;
+  if( commit_max < commit_us )  commit_max  =  commit_us;
+  if( committed )  removed_total  +=  marked;
+  else             ++failed_total;
+}
+
+int main( int argc, char* argv[] ) {
+  std::string  directory  =  ( 1 < argc ) ? argv[1] : ".";
+  unsigned     sessions   =  ( 2 < argc ) ? std::atoi( argv[2] ) : 64;
+  unsigned     messages   =  ( 3 < argc ) ? std::atoi( argv[3] ) : 10000;
+
+  {
+    std::ofstream  idx( ( directory + "/pop3.idx" ).c_str(), std::ios::binary | std::ios::trunc );
+    idx << "POP3IDX 2\n";
+    for( unsigned i = 0; i < messages; ++i ) {
+      std::ostringstream  name;
+      name << "bench" << i << ".eml";
+      std::ofstream  ofs( ( directory + "/" + name.str() ).c_str(), std::ios::binary );
+      ofs << "Subject: bench\r\n\r\nbody\r\n";
+      idx << i << ' ' << 24 << ' ' << 18 << ' ' << 6 << ' ' << name.str() << '\n';
+    }
+  }
+
+  maildrop_registry  registry;
+  {
+    boost::shared_ptr<maildrop_index>  index  =  registry.open( directory );
+    boost::posix_time::ptime  start  =  boost::posix_time::microsec_clock::universal_time();
+    boost::thread_group  group;
+    for( unsigned s = 0; s < sessions; ++s ) {
+      group.create_thread( boost::bind( &run_session, &registry, directory, s, sessions ) );
+    }
+    group.join_all();
+    boost::posix_time::time_duration  elapsed  =  boost::posix_time::microsec_clock::universal_time() - start;
+
+    std::cout << "sessions:        " << sessions << std::endl;
+    std::cout << "messages:        " << messages << std::endl;
+    std::cout << "removed:         " << removed_total << std::endl;
+    std::cout << "failed commits:  " << failed_total << std::endl;
+    std::cout << "left in index:   " << index->snapshot()->size() << std::endl;
+    std::cout << "attach avg (us): " << attach_total / sessions << std::endl;
+    std::cout << "commit avg (us): " << commit_total / sessions << std::endl;
+    std::cout << "commit max (us): " << commit_max << std::endl;
+    std::cout << "elapsed (ms):    " << elapsed.total_milliseconds() << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,54 @@
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+//
+// Copyright (c) 2006-2009 OKI Miyuki (oki.miyuki at gmail dot com)
+//
+//---------------------------------------------------------------------------
+// sample of pop3maildropsession.hpp
+//   USER name is mapped to maildrop directory "name" in current directory.
+//   (any password is accepted)
+//---------------------------------------------------------------------------
+#define WIN32_LEAN_AND_MEAN 
+#include <pop3maildropsession.hpp>
+#include <iostream>
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+
+using namespace rfc::pop3;
+
+class pop3_maildrop_sample_session :
+  public maildrop_session< pop3_maildrop_sample_session >
+{
+public:
+  //! constructor
+  pop3_maildrop_sample_session(
+    boost::asio::io_service& io_service
+  ) :
+    maildrop_session< pop3_maildrop_sample_session >( io_service )
+  {
+  }
+
+  //! check user and password. and get maildrop directory.
+  bool authorize(
+    const std::string& user,
+    const std::string& pass,
+    std::string& directory
+  ) {
+    directory  =  user;
+    return true;
+  }
+};
+
+int main() {
+  boost::asio::io_service  io_service;
+  boost::shared_ptr<admission_control>  admission( new admission_control() );
+  pop3_server<pop3_maildrop_sample_session>  pop3_serv( io_service, 110, admission );
+
+  boost::thread  thr( boost::bind( &pop3_server<pop3_maildrop_sample_session>::run, &pop3_serv ) );
+  getchar();
+  io_service.stop();
+  thr.join();
+  return 0;
+}
@@ -0,0 +1,242 @@
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+//
+// Copyright (c) 2006-2009 OKI Miyuki (oki.miyuki at gmail dot com)
+//
+//---------------------------------------------------------------------------
+// benchmark of file response path (pop3diskio.hpp, pop3maildropsession.hpp)
+//   retrbench [directory] [messages] [message KB]
+//   1. chunked reads of each message by disk_io_executor. reopen per chunk
+//      vs kept stream.
+//   2. "RETR n" for every message through maildrop_session over TCP loopback.
+//---------------------------------------------------------------------------
+#define WIN32_LEAN_AND_MEAN
+#include <pop3maildropsession.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+using namespace rfc::pop3;
+
+//! read size of executor benchmark
+const unsigned long  bench_chunk  =  4096;
+
+//! session for benchmark. USER name is maildrop directory.
+class bench_session :
+  public maildrop_session< bench_session >
+{
+public:
+  //! constructor
+  bench_session( boost::asio::io_service& io_service ) :
+    maildrop_session< bench_session >( io_service )
+  {
+  }
+
+  //! check user and password. and get maildrop directory.
+  bool authorize( const std::string& user, const std::string&, std::string& directory ) {
+    directory  =  user;
+    return true;
+  }
+};
+
+//! chunked reader of messages. one read in flight, like file_transfer.
+class bench_reader {
+public:
+  bench_reader( boost::asio::io_service& io_service, disk_io_executor& executor, const std::vector<std::string>& paths, unsigned long size, bool keep ) :
+    io_service_( io_service ), executor_( executor ), paths_( paths ), size_( size ), keep_( keep ), index_( 0 ), offset_( 0 ), bytes_( 0 ), stream_()
+  {
+  }
+
+  //! read first chunk
+  void start() {
+    stream_.reset( new std::ifstream() );
+    read();
+  }
+
+  //! bytes read
+  unsigned long bytes() const { return bytes_; }
+
+private:
+  void read() {
+    std::size_t  length  =  static_cast<std::size_t>( std::min<unsigned long>( bench_chunk, size_ - offset_ ) );
+    if( keep_ ) {
+      executor_.async_read( io_service_, stream_, paths_[ index_ ], offset_, length,
+        boost::bind( &bench_reader::handle_read, this, _1, _2 ) );
+    } else {
+      executor_.async_read( io_service_, paths_[ index_ ], offset_, length,
+        boost::bind( &bench_reader::handle_read, this, _1, _2 ) );
+    }
+  }
+
+  void handle_read( const boost::system::error_code& error, disk_io_executor::buffer_ptr data ) {
+    if( error ) {
+      io_service_.stop();
+      return;
+    }
+    offset_  +=  static_cast<unsigned long>( data->size() );
+    bytes_   +=  static_cast<unsigned long>( data->size() );
+    if( size_ <= offset_ ) {
+      offset_  =  0;
+      if( paths_.size() <= ++index_ ) {
+        io_service_.stop();
+        return;
+      }
+      stream_.reset( new std::ifstream() );
+    }
+    read();
+  }
+
+private:
+  boost::asio::io_service&          io_service_;
+  disk_io_executor&                 executor_;
+  const std::vector<std::string>&   paths_;
+  unsigned long                     size_;
+  bool                              keep_;
+  std::size_t                       index_;
+  unsigned long                     offset_;
+  unsigned long                     bytes_;
+  boost::shared_ptr<std::ifstream>  stream_;
+};
+
+//! client for benchmark. login, and RETR every message.
+/*!
+  @note response is scanned only for terminator. so client costs little
+    beside the session.
+*/
+class bench_client {
+public:
+  bench_client( boost::asio::io_service& io_service, boost::asio::ip::tcp::socket& stream, const std::string& user, unsigned count ) :
+    io_service_( io_service ), stream_( stream ), user_( user ), count_( count ), sent_( 0 ), bytes_( 0 ), buffer_( 65536 ), tail_(), delim_( "\r\n" ), command_()
+  {
+  }
+
+  //! read greeting
+  void start() {
+    read();
+  }
+
+  //! bytes of RETR responses
+  unsigned long bytes() const { return bytes_; }
+
+private:
+  void read() {
+    stream_.async_read_some(
+      boost::asio::buffer( buffer_ ),
+      boost::bind( &bench_client::handle_read, this, boost::asio::placeholders::error, boost::asio::placeholders::bytes_transferred )
+    );
+  }
+
+  void handle_read( const boost::system::error_code& error, std::size_t length ) {
+    if( error )  return;
+    if( 2 < sent_ )  bytes_  +=  static_cast<unsigned long>( length );
+    tail_.append( &buffer_[0], length );
+    if( tail_.find( delim_ ) == std::string::npos ) {
+      tail_.erase( 0, tail_.size() - std::min( tail_.size(), delim_.size() - 1 ) );
+      read();
+      return;
+    }
+    tail_.clear();
+    if( count_ + 2 <= sent_ ) {
+      io_service_.stop();
+      return;
+    }
+    std::ostringstream  oss;
+    if( sent_ == 0 )       oss << "USER " << user_ << "\r\n";
+    else if( sent_ == 1 )  oss << "PASS bench\r\n";
+    else                   oss << "RETR " << ( sent_ - 1 ) << "\r\n";
+    command_  =  oss.str();
+    ++sent_;
+    delim_  =  ( 2 < sent_ ) ? "\r\n.\r\n" : "\r\n";
+    boost::asio::async_write(
+      stream_, boost::asio::buffer( command_ ),
+      boost::bind( &bench_client::handle_wrote, this, boost::asio::placeholders::error )
+    );
+  }
+
+  void handle_wrote( const boost::system::error_code& error ) {
+    if( !error )  read();
+  }
+
+private:
+  boost::asio::io_service&        io_service_;
+  boost::asio::ip::tcp::socket&   stream_;
+  std::string                     user_;
+  unsigned                        count_;
+  unsigned                        sent_;
+  unsigned long                   bytes_;
+  std::vector<char>               buffer_;
+  std::string                     tail_;    //!< unscanned response (kept for terminator over reads)
+  std::string                     delim_;   //!< terminator of current response
+  std::string                     command_;
+};
+
+namespace {
+  //! print result
+  void report( const char* name, unsigned messages, unsigned long bytes, const boost::posix_time::time_duration& elapsed ) {
+    double  sec  =  elapsed.total_microseconds() / 1000000.0;
+    std::cout << name << ": " << elapsed.total_milliseconds() << " ms, "
+      << ( sec > 0 ? messages / sec : 0 ) << " messages/s, "
+      << ( sec > 0 ? bytes / sec / 1048576.0 : 0 ) << " MB/s" << std::endl;
+  }
+}
+
+int main( int argc, char* argv[] ) {
+  using boost::posix_time::microsec_clock;
+  std::string  directory  =  ( 1 < argc ) ? argv[1] : ".";
+  unsigned     messages   =  ( 2 < argc ) ? std::atoi( argv[2] ) : 200;
+  unsigned     kbytes     =  ( 3 < argc ) ? std::atoi( argv[3] ) : 1024;
+
+  // maildrop
+  std::vector<std::string>  paths;
+  unsigned long  size  =  0;
+  {
+    std::remove( ( directory + "/pop3.idx" ).c_str() );
+    maildrop_registry  registry;
+    boost::shared_ptr<maildrop_index>  index  =  registry.open( directory );
+    std::string  line( 78, 'x' );
+    for( unsigned i = 0; i < messages; ++i ) {
+      std::ostringstream  name;
+      name << "retr" << i << ".eml";
+      {
+        std::ofstream  ofs( ( directory + "/" + name.str() ).c_str(), std::ios::binary | std::ios::trunc );
+        ofs << "From: bench@example.com\r\nSubject: message " << i << "\r\n\r\n";
+        for( unsigned l = 0; l < kbytes * 1024 / 80; ++l )  ofs << line << "\r\n";
+      }
+      index->append( name.str(), name.str() );
+      paths.push_back( directory + "/" + name.str() );
+    }
+    size  =  index->snapshot()->front().size_;
+  }
+  disk_io_executor  executor;
+
+  // executor only
+  for( int keep = 0; keep < 2; ++keep ) {
+    boost::asio::io_service  io_service;
+    boost::asio::io_service::work  work( io_service );
+    bench_reader  reader( io_service, executor, paths, size, keep != 0 );
+    boost::posix_time::ptime  start  =  microsec_clock::universal_time();
+    reader.start();
+    io_service.run();
+    report( keep ? "executor kept stream" : "executor reopen     ", messages, reader.bytes(), microsec_clock::universal_time() - start );
+  }
+
+  // session
+  {
+    boost::asio::io_service  io_service;
+    pop3_server<bench_session>  server( io_service, 11111 );
+    boost::asio::ip::tcp::socket  client( io_service );
+    client.connect( boost::asio::ip::tcp::endpoint( boost::asio::ip::address_v4::loopback(), 11111 ) );
+    bench_client  bench( io_service, client, directory, messages );
+    boost::posix_time::ptime  start  =  microsec_clock::universal_time();
+    bench.start();
+    io_service.run();
+    report( "session RETR        ", messages, bench.bytes(), microsec_clock::universal_time() - start );
+  }
+  return 0;
+}
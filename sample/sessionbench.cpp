@@ -0,0 +1,160 @@
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+//
+// Copyright (c) 2006-2009 OKI Miyuki (oki.miyuki at gmail dot com)
+//
+//---------------------------------------------------------------------------
+// benchmark of pop3 session state machine over each transport (pop3stream.hpp)
+//   sessionbench [commands]
+//   one client sends "STAT" commands one by one, and waits each response.
+//   memory_stream has no syscalls. so it measures parser and session only.
+//---------------------------------------------------------------------------
+#define WIN32_LEAN_AND_MEAN
+#include <pop3server.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+using namespace rfc::pop3;
+
+//! session for benchmark
+template <typename Stream>
+class bench_session :
+  public pop3_session< bench_session<Stream>, Stream >
+{
+public:
+  typedef pop3_session< bench_session<Stream>, Stream >  base_type;
+
+  //! constructor
+  bench_session( boost::asio::io_service& io_service ) : base_type( io_service ) {}
+
+  void response_pass( const std::string&, const std::string& ) {
+    this->state_.into_transaction();
+    this->send_single_response( true, "welcome" );
+  }
+  void response_stat()              { this->send_single_response( true, "0 0" ); }
+  void response_list( unsigned )    { this->send_single_response( false, "no such message" ); }
+  void response_list()              { this->send_single_response( true, "0 messages\r\n." ); }
+  void response_retr( unsigned )    { this->send_single_response( false, "no such message" ); }
+  void response_dele( unsigned )    { this->send_single_response( false, "no such message" ); }
+  void response_rset()              { this->send_single_response( true, "maildrop reset" ); }
+  void response_top( unsigned, unsigned ) { this->send_single_response( false, "no such message" ); }
+  void response_uidl( unsigned )    { this->send_single_response( false, "no such message" ); }
+  void response_uidl()              { this->send_single_response( true, "0 messages\r\n." ); }
+};
+
+//! client for benchmark. login, and send STAT until count is done.
+template <typename Stream>
+class bench_client {
+public:
+  bench_client( boost::asio::io_service& io_service, Stream& stream, unsigned count ) :
+    io_service_( io_service ), stream_( stream ), count_( count ), sent_( 0 ), response_(), command_()
+  {
+  }
+
+  //! read greeting
+  void start() {
+    read();
+  }
+
+private:
+  void read() {
+    boost::asio::async_read_until(
+      stream_, response_, "\r\n",
+      boost::bind( &bench_client::handle_read, this, boost::asio::placeholders::error )
+    );
+  }
+
+  void handle_read( const boost::system::error_code& error ) {
+    if( error )  return;
+    response_.consume( response_.size() );
+    if( count_ + 2 <= sent_ ) {
+      io_service_.stop();
+      return;
+    }
+    if( sent_ == 0 )       command_  =  "USER bench\r\n";
+    else if( sent_ == 1 )  command_  =  "PASS bench\r\n";
+    else                   command_  =  "STAT\r\n";
+    ++sent_;
+    boost::asio::async_write(
+      stream_, boost::asio::buffer( command_ ),
+      boost::bind( &bench_client::handle_wrote, this, boost::asio::placeholders::error )
+    );
+  }
+
+  void handle_wrote( const boost::system::error_code& error ) {
+    if( !error )  read();
+  }
+
+private:
+  boost::asio::io_service&  io_service_;
+  Stream&                  stream_;
+  unsigned                  count_;
+  unsigned                  sent_;
+  boost::asio::streambuf    response_;
+  std::string               command_;
+};
+
+namespace {
+  //! print result
+  void report( const char* name, unsigned count, const boost::posix_time::time_duration& elapsed ) {
+    double  sec  =  elapsed.total_microseconds() / 1000000.0;
+    std::cout << name << ": " << elapsed.total_milliseconds() << " ms, "
+      << ( sec > 0 ? count / sec : 0 ) << " commands/s" << std::endl;
+  }
+}
+
+int main( int argc, char* argv[] ) {
+  using boost::posix_time::microsec_clock;
+  unsigned  count  =  ( 1 < argc ) ? std::atoi( argv[1] ) : 100000;
+
+  // in memory
+  {
+    boost::asio::io_service  io_service;
+    boost::shared_ptr< bench_session<memory_stream> >  session( new bench_session<memory_stream>( io_service ) );
+    memory_stream  client( io_service );
+    session->socket().connect( client );
+    bench_client<memory_stream>  bench( io_service, client, count );
+    boost::posix_time::ptime  start  =  microsec_clock::universal_time();
+    session->start();
+    bench.start();
+    io_service.run();
+    report( "memory_stream", count, microsec_clock::universal_time() - start );
+  }
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+  // Unix domain socket
+  {
+    const char  path[]  =  "sessionbench.sock";
+    std::remove( path );
+    boost::asio::io_service  io_service;
+    pop3_server< bench_session<local_stream>, local_acceptor >  server( io_service, local_acceptor::endpoint_type( path ) );
+    local_stream  client( io_service );
+    client.connect( local_acceptor::endpoint_type( path ) );
+    bench_client<local_stream>  bench( io_service, client, count );
+    boost::posix_time::ptime  start  =  microsec_clock::universal_time();
+    bench.start();
+    io_service.run();
+    report( "local_stream ", count, microsec_clock::universal_time() - start );
+    std::remove( path );
+  }
+#endif  // defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+
+  // TCP loopback
+  {
+    boost::asio::io_service  io_service;
+    pop3_server< bench_session<boost::asio::ip::tcp::socket> >  server( io_service, 11110 );
+    boost::asio::ip::tcp::socket  client( io_service );
+    client.connect( boost::asio::ip::tcp::endpoint( boost::asio::ip::address_v4::loopback(), 11110 ) );
+    bench_client<boost::asio::ip::tcp::socket>  bench( io_service, client, count );
+    boost::posix_time::ptime  start  =  microsec_clock::universal_time();
+    bench.start();
+    io_service.run();
+    report( "tcp loopback ", count, microsec_clock::universal_time() - start );
+  }
+  return 0;
+}
@@ -0,0 +1,113 @@
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+//
+// Copyright (c) 2006-2009 OKI Miyuki (oki.miyuki at gmail dot com)
+//
+//---------------------------------------------------------------------------
+// benchmark of TOP index (pop3maildrop.hpp, pop3mbox.hpp)
+//   topbench [directory] [messages] [body lines]
+//   "TOP n 0" for every message. indexed range vs reading whole message.
+//---------------------------------------------------------------------------
+#include <pop3maildrop.hpp>
+#include <pop3mbox.hpp>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+using namespace rfc::pop3;
+
+namespace {
+  //! write test message
+  void write_message( std::ostream& os, unsigned number, unsigned lines ) {
+    os << "From: bench@example.com\r\nSubject: message " << number << "\r\n\r\n";
+    for( unsigned i = 0; i < lines; ++i )  os << "body line " << i << " of message " << number << "\r\n";
+  }
+
+  //! print result
+  void report( const char* name, unsigned messages, unsigned long bytes, const boost::posix_time::time_duration& elapsed ) {
+    double  sec  =  elapsed.total_microseconds() / 1000000.0;
+    std::cout << name << ": " << elapsed.total_milliseconds() << " ms, "
+      << ( sec > 0 ? messages / sec : 0 ) << " TOP/s, " << bytes << " bytes read" << std::endl;
+  }
+}
+
+int main( int argc, char* argv[] ) {
+  using boost::posix_time::microsec_clock;
+  std::string  directory  =  ( 1 < argc ) ? argv[1] : ".";
+  unsigned     messages   =  ( 2 < argc ) ? std::atoi( argv[2] ) : 10000;
+  unsigned     lines      =  ( 3 < argc ) ? std::atoi( argv[3] ) : 500;
+
+  // maildrop
+  {
+    std::ofstream  idx( ( directory + "/pop3.idx" ).c_str(), std::ios::binary | std::ios::trunc );
+    for( unsigned i = 0; i < messages; ++i ) {
+      std::ostringstream  name;
+      name << "top" << i << ".eml";
+      {
+        std::ofstream  ofs( ( directory + "/" + name.str() ).c_str(), std::ios::binary );
+        write_message( ofs, i, lines );
+      }
+      maildrop_message  msg;
+      index_message( directory + "/" + name.str(), msg );
+      idx << name.str() << ' ' << msg.size_ << ' ' << msg.header_end_ << ' ';
+      for( std::size_t l = 0; l < msg.body_lines_.size(); ++l )  idx << ( l ? "," : "" ) << msg.body_lines_[l];
+      idx << ' ' << name.str() << '\n';
+    }
+  }
+  maildrop_registry  registry;
+  maildrop_view  view;
+  view.attach( registry.open( directory ) );
+  std::vector<char>  buffer;
+
+  unsigned long  bytes  =  0;
+  boost::posix_time::ptime  start  =  microsec_clock::universal_time();
+  for( unsigned n = 1; n <= view.size(); ++n ) {
+    unsigned long  length  =  0;
+    view.top_length( n, 0, length );
+    buffer.resize( length );
+    std::ifstream  ifs( view.path( n ).c_str(), std::ios::binary );
+    ifs.read( &buffer[0], length );
+    bytes  +=  static_cast<unsigned long>( ifs.gcount() );
+  }
+  report( "maildrop indexed", view.size(), bytes, microsec_clock::universal_time() - start );
+
+  bytes  =  0;
+  start  =  microsec_clock::universal_time();
+  for( unsigned n = 1; n <= view.size(); ++n ) {
+    std::ifstream  ifs( view.path( n ).c_str(), std::ios::binary );
+    std::string  line;
+    while( std::getline( ifs, line ) )  bytes  +=  static_cast<unsigned long>( line.size() ) + 1;
+  }
+  report( "maildrop naive  ", view.size(), bytes, microsec_clock::universal_time() - start );
+
+  // mbox
+  std::string  mbox_path  =  directory + "/top.mbox";
+  {
+    std::ofstream  ofs( mbox_path.c_str(), std::ios::binary | std::ios::trunc );
+    for( unsigned i = 0; i < messages; ++i ) {
+      ofs << "From bench@example.com Thu Jan  1 00:00:00 2009\n";
+      write_message( ofs, i, lines );
+      ofs << "\n";
+    }
+  }
+  std::remove( ( mbox_path + ".pidx" ).c_str() );
+  start  =  microsec_clock::universal_time();
+  mbox_file  mbox( mbox_path );
+  report( "mbox index build", static_cast<unsigned>( mbox.size() ), 0, microsec_clock::universal_time() - start );
+
+  bytes  =  0;
+  start  =  microsec_clock::universal_time();
+  std::vector<boost::asio::const_buffer>  buffers;
+  for( std::size_t i = 0; i < mbox.size(); ++i ) {
+    buffers.clear();
+    boost::uint64_t  last  =  mbox.top_end( i, 0 );
+    mbox.segments( i, mbox.entry( i ).offset_, last, static_cast<std::size_t>( last - mbox.entry( i ).offset_ ), buffers );
+    bytes  +=  static_cast<unsigned long>( boost::asio::buffer_size( buffers ) );
+  }
+  report( "mbox TOP n 0    ", static_cast<unsigned>( mbox.size() ), bytes, microsec_clock::universal_time() - start );
+  return 0;
+}
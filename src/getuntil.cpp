@@ -11,10 +11,61 @@
 #include <fstream>
 #include <sstream>
 #include <iomanip>
+#include <cstdlib>
 
 #include <boost/asio.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
 
-int main() {
+namespace {
+  //! print throughput
+  void report( const char* name, std::size_t bytes, const boost::posix_time::time_duration& elapsed ) {
+    double  sec  =  elapsed.total_microseconds() / 1000000.0;
+    std::cout << name << ": " << elapsed.total_milliseconds() << " ms, "
+      << ( sec > 0 ? bytes / sec / ( 1024 * 1024 ) : 0 ) << " MB/s" << std::endl;
+  }
+
+  //! throughput of getuntil. (std::getline is reference)
+  void benchmark( std::size_t megabytes ) {
+    using boost::posix_time::microsec_clock;
+    std::string  data;
+    data.reserve( megabytes * 1024 * 1024 );
+    for( unsigned i = 0; data.size() < megabytes * 1024 * 1024; ++i ) {
+      data  +=  "Received: from mail.example.com by pop3 server; line ";
+      data  +=  std::string( i % 64, 'x' );
+      data  +=  "\r\n";
+    }
+    std::string  line;
+    std::size_t  count  =  0;
+    {
+      std::istringstream  iss( data );
+      boost::posix_time::ptime  start  =  microsec_clock::universal_time();
+      while( std::getline( iss, line, '\n' ) )  ++count;
+      report( "std::getline  (stringstream)", data.size(), microsec_clock::universal_time() - start );
+    }
+    {
+      std::istringstream  iss( data );
+      boost::posix_time::ptime  start  =  microsec_clock::universal_time();
+      while( getuntil( iss, line, "\r\n" ) )  --count;
+      report( "getuntil      (stringstream)", data.size(), microsec_clock::universal_time() - start );
+    }
+    {
+      boost::asio::streambuf  sb;
+      std::ostream  ostrm( &sb );
+      ostrm << data;
+      std::istream  istrm( &sb );
+      boost::posix_time::ptime  start  =  microsec_clock::universal_time();
+      while( getuntil( istrm, line, "\r\n" ) ) {}
+      report( "getuntil (asio::streambuf)", data.size(), microsec_clock::universal_time() - start );
+    }
+    if( count != 0 )  std::cout << "line count mismatch" << std::endl;
+  }
+}
+
+//! sample and benchmark of getuntil
+/*!
+  @note getuntil [megabytes of benchmark]
+*/
+int main( int argc, char* argv[] ) {
   std::ifstream ifs( "src/getuntil.cpp", std::ios::binary );
 
   int i  =  0;
@@ -52,5 +103,9 @@ int main() {
     getuntil( istrm, line, "\r\n" );
     std::cout << line;
   }
-}
 
+  std::cout << std::endl;
+  std::cout << "Enter benchmark" << std::endl;
+
+  benchmark( ( 1 < argc ) ? std::atoi( argv[1] ) : 64 );
+}
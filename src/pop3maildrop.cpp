@@ -0,0 +1,691 @@
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+//
+// Copyright (c) 2006-2009 OKI Miyuki (oki.miyuki at gmail dot com)
+//
+
+#include <pop3maildrop.hpp>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <fstream>
+#include <sstream>
+#include <set>
+#include <boost/assert.hpp>
+#include <sys/types.h>
+#include <sys/stat.h>
+#if !defined(_WIN32)
+# include <fcntl.h>
+# include <unistd.h>
+#endif // !defined(_WIN32)
+
+namespace rfc {
+namespace pop3 {
+
+namespace {
+  const char index_name[]     =  "pop3.idx";
+  const char index_temp[]     =  "pop3.idx.tmp";
+  const char index_lock[]     =  "pop3.lock";
+  const char index_version[]  =  "POP3IDX 2";  //!< first line of index file
+
+  //! parse one line of index file
+  /*!
+    @note line of version 2 is "UIDL SIZE HEADER_END BODY_LINES FILE", and
+      line of version 1 (no version line) is "UIDL SIZE FILE". legacy is set
+      for version 1 line, and HEADER_END and BODY_LINES are left unset.
+    @retval true parsed
+    @retval false broken line
+  */
+  bool parse_index_line(
+    const std::string&  line,   //!< [in] line of index file
+    bool                v2,     //!< [in] file has version 2 line
+    maildrop_message&   msg,    //!< [out] message
+    bool&               legacy  //!< [out] line is version 1
+  ) {
+    std::istringstream  iss( line );
+    if( !(iss >> msg.uidl_ >> msg.size_) )  return false;
+    std::istringstream::pos_type  rest  =  iss.tellg();
+    std::string  lines;
+    legacy  =  !(iss >> msg.header_end_ >> lines)
+      || lines.find_first_not_of( lines == "-" ? "-" : "0123456789," ) != std::string::npos;
+    if( legacy ) {
+      // version 1 line in file without version line. FILE follows SIZE.
+      if( v2 )  return false;
+      iss.clear();
+      iss.seekg( rest );
+      msg.header_end_  =  0;
+    } else if( lines != "-" ) {
+      std::istringstream  liss( lines );
+      unsigned  end  =  0;
+      while( liss >> end ) {
+        msg.body_lines_.push_back( end );
+        liss.ignore( 1 );  // ','
+      }
+    }
+    iss >> std::ws;
+    std::getline( iss, msg.file_ );
+    return !msg.file_.empty();
+  }
+
+  //! write one line of index file (version 2)
+  void write_index_line(
+    std::ostream&             os,   //!< [in,out] index file
+    const maildrop_message&   msg   //!< [in] message
+  ) {
+    os << msg.uidl_ << ' ' << msg.size_ << ' ' << msg.header_end_ << ' ';
+    if( msg.body_lines_.empty() )  os << '-';
+    for( std::size_t i = 0; i < msg.body_lines_.size(); ++i ) {
+      if( i )  os << ',';
+      os << msg.body_lines_[i];
+    }
+    os << ' ' << msg.file_ << '\n';
+  }
+
+  //! lock of index file between processes. (fcntl lock of "pop3.lock")
+  /*!
+    @note pop3.idx is replaced by rename, so lock is taken on other file
+      which is never replaced. fcntl lock does not exclude threads of same
+      process, so caller holds commit_mutex_ too.
+    @attention if lock file can not be opened (e.g. read only directory),
+      index is used without lock.
+  */
+  class file_lock : private boost::noncopyable {
+  public:
+    explicit file_lock( const std::string& path ) : fd_( -1 ) {
+#if !defined(_WIN32)
+      fd_  =  ::open( path.c_str(), O_RDWR | O_CREAT, 0644 );
+      if( fd_ < 0 )  return;
+      struct flock  fl;
+      std::memset( &fl, 0, sizeof( fl ) );
+      fl.l_type    =  F_WRLCK;
+      fl.l_whence  =  SEEK_SET;
+      while( ::fcntl( fd_, F_SETLKW, &fl ) != 0 && errno == EINTR ) {}
+#endif // !defined(_WIN32)
+    }
+    ~file_lock() {
+#if !defined(_WIN32)
+      if( 0 <= fd_ )  ::close( fd_ );  // releases lock
+#endif // !defined(_WIN32)
+    }
+  private:
+    int  fd_;
+  };
+
+  //! deleter of published list. releases its generation.
+  struct list_deleter {
+    boost::shared_ptr<maildrop_unlinks>  generation_;
+
+    explicit list_deleter( const boost::shared_ptr<maildrop_unlinks>& generation ) : generation_( generation ) {}
+    void operator()( const maildrop_list* list ) {
+      delete list;
+      generation_.reset();
+    }
+  };
+}
+
+//! message files to unlink after snapshots are released
+/*!
+  @note lists published between two commits share one generation, and each
+    generation holds next one. so files removed by a commit are unlinked
+    when every list published before the commit is released.
+*/
+struct maildrop_unlinks : private boost::noncopyable {
+  std::vector<std::string>             files_;  //!< files removed by commit which ended this generation
+  boost::shared_ptr<maildrop_unlinks>  next_;   //!< next generation
+
+  //! destructor. unlink files. and release next generations without recursion.
+  ~maildrop_unlinks() {
+    for( std::vector<std::string>::const_iterator it = files_.begin(); it != files_.end(); ++it ) {
+      std::remove( it->c_str() );
+    }
+    boost::shared_ptr<maildrop_unlinks>  next;
+    next.swap( next_ );
+    while( next && next.unique() ) {
+      boost::shared_ptr<maildrop_unlinks>  after;
+      after.swap( next->next_ );
+      next  =  after;
+    }
+  }
+};
+
+/*!
+  @defgroup pop3server_maildrop POP3 maildrop for server
+*/
+
+//! constructor
+maildrop_message::maildrop_message() :
+  uidl_(),
+  file_(),
+  size_(0),
+  header_end_(0),
+  body_lines_()
+{
+}
+
+//! index message file. (size, header end and first body lines)
+/*!
+  @note run once when message is delivered. so TOP can be served as one
+    file range without reading body.
+  @note size_ is octets sent by RETR. bare LF is sent as CRLF, so it is
+    counted as two octets. header_end_ and body_lines_ are file positions.
+  @ingroup pop3server_maildrop
+  @retval true indexed
+  @retval false can not open file
+*/
+bool index_message(
+  const std::string&  path, //!< [in] message file path
+  maildrop_message&   msg   //!< [out,ref] size_, header_end_ and body_lines_ are set
+) {
+  std::ifstream  ifs( path.c_str(), std::ios::binary );
+  if( !ifs )  return false;
+  unsigned  pos        =  0;
+  unsigned  bare_lf    =  0;
+  bool      in_header  =  true;
+  std::string  line;
+  msg.header_end_  =  0;
+  msg.body_lines_.clear();
+  while( std::getline( ifs, line ) ) {
+    bool  newline  =  !ifs.eof();
+    pos  +=  static_cast<unsigned>( line.size() ) + ( newline ? 1 : 0 );
+    if( newline && ( line.empty() || *line.rbegin() != '\r' ) )  ++bare_lf;
+    if( in_header ) {
+      if( line.empty() || line == "\r" ) {
+        in_header        =  false;
+        msg.header_end_  =  pos;
+      }
+    } else if( msg.body_lines_.size() < maildrop_top_lines ) {
+      msg.body_lines_.push_back( pos - msg.header_end_ );
+    }
+  }
+  msg.size_  =  pos + bare_lf;
+  if( in_header )  msg.header_end_  =  pos;
+  return true;
+}
+
+//! constructor. load index file of directory.
+maildrop_index::maildrop_index(
+  const std::string& directory  //!< [in] maildrop directory
+) :
+  directory_( directory ),
+  generation_( new maildrop_unlinks() ),
+  current_(),
+  index_ino_( 0 ),
+  index_size_( 0 ),
+  index_mtime_( 0 )
+{
+  file_lock  lock( path_of( index_lock ) );
+  load();
+}
+
+//! take current snapshot
+/*!
+  @note lock is held only while copying pointer.
+  @ingroup pop3server_maildrop
+  @retval snapshot of messages
+*/
+maildrop_snapshot maildrop_index::snapshot() const {
+  boost::mutex::scoped_lock  lock( mutex_ );
+  return current_;
+}
+
+//! append new message (for delivery agent)
+/*!
+  @ingroup pop3server_maildrop
+  @note one line is appended to index file. so cost of delivery does not
+    grow with maildrop size on disk. (list in memory is still copied for
+    snapshot)
+  @ingroup pop3server_maildrop
+  @retval true appended
+  @retval false index file can not be written
+*/
+bool maildrop_index::append(
+  const maildrop_message& msg  //!< [in] delivered message
+) {
+  boost::mutex::scoped_lock  commit_lock( commit_mutex_ );
+  file_lock  lock( path_of( index_lock ) );
+  if( changed() )  load();
+  maildrop_snapshot  base  =  snapshot();
+  maildrop_list*  next  =  new maildrop_list();
+  maildrop_snapshot  published  =  publish( next );
+  next->reserve( base->size() + 1 );
+  next->assign( base->begin(), base->end() );
+  next->push_back( msg );
+  std::string  name  =  path_of( index_name );
+  bool  fresh  =  false;
+  {
+    std::ifstream  probe( name.c_str(), std::ios::binary );
+    fresh  =  !probe || probe.peek() == std::ifstream::traits_type::eof();
+  }
+  bool  written  =  false;
+  {
+    std::ostringstream  oss;
+    if( fresh )  oss << index_version << '\n';
+    write_index_line( oss, msg );
+    std::string  line  =  oss.str();
+    std::ofstream  ofs( name.c_str(), std::ios::binary | std::ios::app );
+    ofs.write( line.data(), static_cast<std::streamsize>( line.size() ) );
+    ofs.close();
+    written  =  !ofs.fail();
+  }
+  // partial line may be left. replace whole index with list before append.
+  if( !written ) {
+    rewrite( *base );
+    stamp();
+    return false;
+  }
+  stamp();
+  boost::mutex::scoped_lock  current_lock( mutex_ );
+  current_  =  published;
+  return true;
+}
+
+//! index message file and append it (for delivery agent)
+/*!
+  @ingroup pop3server_maildrop
+  @retval true appended
+  @retval false can not open message file, or index file can not be written
+*/
+bool maildrop_index::append(
+  const std::string& file,  //!< [in] message file name (relative to maildrop directory)
+  const std::string& uidl   //!< [in] unique-id
+) {
+  maildrop_message  msg;
+  msg.uidl_  =  uidl;
+  msg.file_  =  file;
+  if( !index_message( path_of( file ), msg ) )  return false;
+  return append( msg );
+}
+
+//! remove deleted messages of snapshot. and rewrite index once.
+/*!
+  @note messages are matched by UIDL. so messages already removed by other
+    session or appended after snapshot are left alone. Message files are
+    unlinked when all snapshots taken before this commit are released.
+    (see maildrop_unlinks) index file changed by other process is loaded
+    before rewrite, so messages appended by it are kept.
+  @attention if index can not be rewritten (e.g. disk full), nothing is
+    removed and false is returned.
+  @ingroup pop3server_maildrop
+  @retval true all deleted messages are removed (or already removed by other session)
+  @retval false index can not be rewritten. no message is removed
+*/
+bool maildrop_index::commit(
+  const maildrop_snapshot&  snap,     //!< [in] session snapshot
+  const std::vector<bool>&  deleted   //!< [in] deletion bitmap of snapshot
+) {
+  BOOST_ASSERT( snap && snap->size() == deleted.size() );
+  std::set<std::string>  uidls;
+  for( std::size_t i = 0; i < deleted.size(); ++i ) {
+    if( deleted[i] )  uidls.insert( (*snap)[i].uidl_ );
+  }
+  if( uidls.empty() )  return true;
+
+  boost::mutex::scoped_lock  commit_lock( commit_mutex_ );
+  file_lock  lock( path_of( index_lock ) );
+  if( changed() )  load();
+  maildrop_snapshot  base  =  snapshot();
+  std::vector<std::string>  unlinks;
+  boost::shared_ptr<maildrop_unlinks>  generation( new maildrop_unlinks() );
+  maildrop_list*  next  =  new maildrop_list();
+  maildrop_snapshot  published( next, list_deleter( generation ) );
+  next->reserve( base->size() );
+  for( maildrop_list::const_iterator it = base->begin(); it != base->end(); ++it ) {
+    if( uidls.count( it->uidl_ ) )  unlinks.push_back( path_of( it->file_ ) );
+    else                            next->push_back( *it );
+  }
+  if( unlinks.empty() )  return true;
+  // index is not changed. so message files must be left too.
+  if( !rewrite( *next ) )  return false;
+  stamp();
+  // files are unlinked when lists of ending generation (include base) are released.
+  generation_->files_.swap( unlinks );
+  generation_->next_  =  generation;
+  generation_  =  generation;
+  boost::mutex::scoped_lock  current_lock( mutex_ );
+  current_  =  published;
+  return true;
+}
+
+//! reload index file if it is changed by other process
+/*!
+  @note index file is compared by inode, size and mtime. so it is not read
+    while it is not changed.
+  @attention blocks on file I/O. run on disk_io_executor.
+  @ingroup pop3server_maildrop
+*/
+void maildrop_index::refresh() {
+  boost::mutex::scoped_lock  commit_lock( commit_mutex_ );
+  if( !changed() )  return;
+  file_lock  lock( path_of( index_lock ) );
+  if( changed() )  load();
+}
+
+//! maildrop directory
+const std::string& maildrop_index::directory() const {
+  return directory_;
+}
+
+//! load index file
+/*!
+  @note index without version line is written by older version. its
+    messages are indexed again (index_message), and the index is rewritten
+    in current format. so no message is dropped by the format change.
+  @attention caller holds file_lock (and commit_mutex_ after construction).
+*/
+void maildrop_index::load() {
+  maildrop_list*  list  =  new maildrop_list();
+  maildrop_snapshot  loaded  =  publish( list );
+  std::ifstream  ifs( path_of( index_name ).c_str() );
+  std::string  line;
+  bool  v2        =  false;
+  bool  migrate   =  false;
+  bool  first     =  true;
+  while( std::getline( ifs, line ) ) {
+    // last line without newline is half written by interrupted append.
+    // it is dropped by rewrite, so next append does not join it.
+    if( ifs.eof() ) {
+      migrate  =  true;
+      break;
+    }
+    if( !line.empty() && *line.rbegin() == '\r' )  line.erase( line.size() - 1 );
+    if( first ) {
+      first  =  false;
+      v2     =  ( line == index_version );
+      if( v2 )  continue;
+    }
+    maildrop_message  msg;
+    bool              legacy  =  false;
+    if( !parse_index_line( line, v2, msg, legacy ) )  continue;
+    if( legacy ) {
+      // size of index is kept if message file can not be read.
+      unsigned  size  =  msg.size_;
+      if( !index_message( path_of( msg.file_ ), msg ) ) {
+        msg.size_        =  size;
+        msg.header_end_  =  size;
+      }
+    }
+    migrate  =  migrate || !v2;
+    list->push_back( msg );
+  }
+  if( migrate )  rewrite( *list );
+  stamp();
+  boost::mutex::scoped_lock  lock( mutex_ );
+  current_  =  loaded;
+}
+
+//! rewrite index file
+/*!
+  @note write to temporary file and rename it. so readers never see half
+    written index.
+  @retval true index file is replaced
+  @retval false write or rename failed. index file is not changed
+*/
+bool maildrop_index::rewrite(
+  const maildrop_list& list  //!< [in] new message list
+) const {
+  std::string  temp  =  path_of( index_temp );
+  std::string  name  =  path_of( index_name );
+  {
+    std::ofstream  ofs( temp.c_str(), std::ios::binary | std::ios::trunc );
+    ofs << index_version << '\n';
+    for( maildrop_list::const_iterator it = list.begin(); it != list.end(); ++it ) {
+      write_index_line( ofs, *it );
+    }
+    ofs.close();
+    if( !ofs ) {
+      std::remove( temp.c_str() );
+      return false;
+    }
+  }
+#if defined(_WIN32)
+  std::remove( name.c_str() );
+#endif // defined(_WIN32)
+  if( std::rename( temp.c_str(), name.c_str() ) != 0 ) {
+    std::remove( temp.c_str() );
+    return false;
+  }
+  return true;
+}
+
+//! record identity of index file. (after load or write)
+void maildrop_index::stamp() {
+  index_stat( index_ino_, index_size_, index_mtime_ );
+}
+
+//! inspect index file is changed after load or write
+bool maildrop_index::changed() const {
+  boost::uint64_t  ino    =  0;
+  boost::uint64_t  size   =  0;
+  boost::int64_t   mtime  =  0;
+  index_stat( ino, size, mtime );
+  return ino != index_ino_ || size != index_size_ || mtime != index_mtime_;
+}
+
+//! get identity of index file. all 0 if not exist.
+void maildrop_index::index_stat(
+  boost::uint64_t&  ino,    //!< [out] inode (0 on Windows)
+  boost::uint64_t&  size,   //!< [out] size
+  boost::int64_t&   mtime   //!< [out] modification time
+) const {
+  ino    =  0;
+  size   =  0;
+  mtime  =  0;
+#if defined(_WIN32)
+  struct _stat64  st;
+  if( ::_stat64( path_of( index_name ).c_str(), &st ) != 0 )  return;
+#else
+  struct stat  st;
+  if( ::stat( path_of( index_name ).c_str(), &st ) != 0 )  return;
+  ino    =  static_cast<boost::uint64_t>( st.st_ino );
+#endif // defined(_WIN32)
+  size   =  static_cast<boost::uint64_t>( st.st_size );
+  mtime  =  static_cast<boost::int64_t>( st.st_mtime );
+}
+
+//! wrap list as snapshot of current generation
+/*!
+  @attention caller holds commit_mutex_ (or constructs index).
+*/
+maildrop_snapshot maildrop_index::publish(
+  maildrop_list* list  //!< [in] new list (owned by snapshot)
+) const {
+  return maildrop_snapshot( list, list_deleter( generation_ ) );
+}
+
+//! full path of file in maildrop directory
+std::string maildrop_index::path_of(
+  const std::string& file  //!< [in] file name
+) const {
+  if( directory_.empty() )  return file;
+  return directory_ + "/" + file;
+}
+
+//! open (or share) maildrop index of directory
+/*!
+  @note index lives while any session holds it. registry is locked only to
+    look up and store index. index is loaded without lock, so open of other
+    maildrop is not blocked by load (or conversion) of large index. shared
+    index is reloaded if index file is changed by other process, and entries
+    of released indexes are removed when new index is stored.
+  @attention blocks on file I/O. run on disk_io_executor.
+  @ingroup pop3server_maildrop
+  @retval shared maildrop index
+*/
+boost::shared_ptr<maildrop_index> maildrop_registry::open(
+  const std::string& directory  //!< [in] maildrop directory
+) {
+  boost::shared_ptr<maildrop_index>  index;
+  {
+    boost::mutex::scoped_lock  lock( mutex_ );
+    std::map< std::string, boost::weak_ptr<maildrop_index> >::iterator  it  =  drops_.find( directory );
+    if( it != drops_.end() )  index  =  it->second.lock();
+  }
+  if( index ) {
+    index->refresh();
+    return index;
+  }
+  index.reset( new maildrop_index( directory ) );
+  boost::mutex::scoped_lock  lock( mutex_ );
+  // same maildrop may be opened meanwhile. sessions must share one index.
+  boost::shared_ptr<maildrop_index>  opened  =  drops_[ directory ].lock();
+  if( opened )  return opened;
+  std::map< std::string, boost::weak_ptr<maildrop_index> >::iterator  it  =  drops_.begin();
+  while( it != drops_.end() ) {
+    if( it->second.expired() )  drops_.erase( it++ );
+    else                        ++it;
+  }
+  drops_[ directory ]  =  index;
+  return index;
+}
+
+//! constructor
+maildrop_view::maildrop_view() :
+  index_(),
+  snapshot_(),
+  deleted_(),
+  deleted_count_(0),
+  deleted_octets_(0)
+{
+}
+
+//! take snapshot of maildrop
+/*!
+  @ingroup pop3server_maildrop
+*/
+void maildrop_view::attach(
+  const boost::shared_ptr<maildrop_index>& index  //!< [in] shared maildrop index
+) {
+  index_          =  index;
+  snapshot_       =  index->snapshot();
+  deleted_.assign( snapshot_->size(), false );
+  deleted_count_  =  0;
+  deleted_octets_ =  0;
+}
+
+//! release snapshot without commit
+void maildrop_view::detach() {
+  index_.reset();
+  snapshot_.reset();
+  deleted_.clear();
+  deleted_count_  =  0;
+  deleted_octets_ =  0;
+}
+
+//! inspect view is attached
+bool maildrop_view::attached() const {
+  return snapshot_.get() != 0;
+}
+
+//! inspect message number is exist and not deleted
+/*!
+  @retval true valid message number
+  @retval false out of range or deleted
+*/
+bool maildrop_view::valid(
+  unsigned number  //!< [in] message number (1 origin)
+) const {
+  return snapshot_ && 0 < number && number <= snapshot_->size() && !deleted_[ number - 1 ];
+}
+
+//! get message
+const maildrop_message& maildrop_view::message(
+  unsigned number  //!< [in] message number (1 origin)
+) const {
+  BOOST_ASSERT( snapshot_ && 0 < number && number <= snapshot_->size() );
+  return (*snapshot_)[ number - 1 ];
+}
+
+//! get full path of message file
+std::string maildrop_view::path(
+  unsigned number  //!< [in] message number (1 origin)
+) const {
+  BOOST_ASSERT( index_ );
+  if( index_->directory().empty() )  return message( number ).file_;
+  return index_->directory() + "/" + message( number ).file_;
+}
+
+//! number of messages in snapshot (include deleted)
+unsigned maildrop_view::size() const {
+  return snapshot_ ? static_cast<unsigned>( snapshot_->size() ) : 0;
+}
+
+//! number of messages (exclude deleted)
+unsigned maildrop_view::count() const {
+  return size() - deleted_count_;
+}
+
+//! total octets of messages (exclude deleted)
+unsigned long maildrop_view::octets() const {
+  unsigned long  total  =  0;
+  for( unsigned i = 1; i <= size(); ++i )  total  +=  message( i ).size_;
+  return total - deleted_octets_;
+}
+
+//! length of TOP response range from head of message
+/*!
+  @note if range is not known from index (more lines than indexed), length
+    is set to whole message and false is returned. then caller limits body
+    lines while sending (see pop3_session::send_file_response).
+  @ingroup pop3server_maildrop
+  @retval true length is exact range of TOP response
+  @retval false length is whole message. body lines must be limited
+*/
+bool maildrop_view::top_length(
+  unsigned        number, //!< [in] message number (1 origin)
+  unsigned        lines,  //!< [in] number of body lines
+  unsigned long&  length  //!< [out,ref] length from head of message
+) const {
+  const maildrop_message&  msg  =  message( number );
+  if( lines == 0 ) {
+    length  =  msg.header_end_;
+    return true;
+  }
+  if( lines <= msg.body_lines_.size() ) {
+    length  =  msg.header_end_ + msg.body_lines_[ lines - 1 ];
+    return true;
+  }
+  length  =  msg.size_;
+  return msg.body_lines_.size() < maildrop_top_lines;
+}
+
+//! mark message as deleted
+/*!
+  @ingroup pop3server_maildrop
+  @retval true marked
+  @retval false invalid message number or already deleted
+*/
+bool maildrop_view::dele(
+  unsigned number  //!< [in] message number (1 origin)
+) {
+  if( !valid( number ) )  return false;
+  deleted_[ number - 1 ]  =  true;
+  ++deleted_count_;
+  deleted_octets_  +=  message( number ).size_;
+  return true;
+}
+
+//! unmark all deleted messages
+void maildrop_view::rset() {
+  deleted_.assign( deleted_.size(), false );
+  deleted_count_  =  0;
+  deleted_octets_ =  0;
+}
+
+//! commit deletions to maildrop. and detach.
+/*!
+  @note call this on QUIT in transaction (UPDATE state).
+  @ingroup pop3server_maildrop
+  @retval true all deleted messages are removed
+  @retval false some deleted messages are not removed
+*/
+bool maildrop_view::commit() {
+  bool  result  =  true;
+  if( index_ && deleted_count_ )  result  =  index_->commit( snapshot_, deleted_ );
+  detach();
+  return result;
+}
+
+}  // namespace pop3
+}  // namespace rfc
@@ -0,0 +1,631 @@
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+//
+// Copyright (c) 2006-2009 OKI Miyuki (oki.miyuki at gmail dot com)
+//
+
+#include <pop3mbox.hpp>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <ctime>
+#include <fstream>
+#include <algorithm>
+#include <boost/thread/thread.hpp>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#if defined(_WIN32)
+# include <io.h>
+#else
+# include <unistd.h>
+# include <signal.h>
+#endif // defined(_WIN32)
+
+namespace rfc {
+namespace pop3 {
+
+namespace {
+  const char            cache_suffix[]  =  ".pidx";
+  const boost::uint32_t cache_magic     =  0x33444950;  // "PID3"
+  const char            lock_suffix[]   =  ".lock";
+  const unsigned        lock_retries    =  100;         // x 100ms
+  const std::time_t     lock_stale      =  300;         // seconds
+  const char            crlf_str[]      =  "\r\n";
+  const char            dot_str[]       =  ".";
+  const char            term_str[]      =  ".\r\n";
+
+  //! modification time of file. -1 if not exist.
+  boost::int64_t file_mtime( const std::string& path ) {
+#if defined(_WIN32)
+    struct _stat64  st;
+    if( _stat64( path.c_str(), &st ) != 0 )  return -1;
+#else
+    struct stat  st;
+    if( ::stat( path.c_str(), &st ) != 0 )  return -1;
+#endif // defined(_WIN32)
+    return static_cast<boost::int64_t>( st.st_mtime );
+  }
+
+  //! size of file. 0 if not exist.
+  boost::uint64_t file_size( const std::string& path ) {
+    std::ifstream  ifs( path.c_str(), std::ios::binary );
+    if( !ifs )  return 0;
+    ifs.seekg( 0, std::ios::end );
+    return static_cast<boost::uint64_t>( ifs.tellg() );
+  }
+
+  //! inspect line begins with "From "
+  bool is_from_line( const char* p, const char* end ) {
+    return 5 <= end - p && std::memcmp( p, "From ", 5 ) == 0;
+  }
+
+  //! FNV-1a hash
+  boost::uint64_t fnv1a( const char* p, const char* end, boost::uint64_t h = 14695981039346656037ULL ) {
+    for( ; p != end; ++p ) {
+      h  ^=  static_cast<unsigned char>( *p );
+      h  *=  1099511628211ULL;
+    }
+    return h;
+  }
+
+  template <typename T>
+  void write_pod( std::ostream& os, const T& value ) {
+    os.write( reinterpret_cast<const char*>( &value ), sizeof( value ) );
+  }
+
+  template <typename T>
+  bool read_pod( std::istream& is, T& value ) {
+    is.read( reinterpret_cast<char*>( &value ), sizeof( value ) );
+    return is.good();
+  }
+
+  template <typename T>
+  void write_positions( std::ostream& os, const std::vector<T>& v ) {
+    write_pod( os, static_cast<boost::uint64_t>( v.size() ) );
+    if( !v.empty() )  os.write( reinterpret_cast<const char*>( &v[0] ), v.size() * sizeof( v[0] ) );
+  }
+
+  template <typename T>
+  bool read_positions( std::istream& is, std::vector<T>& v ) {
+    boost::uint64_t  n  =  0;
+    if( !read_pod( is, n ) )  return false;
+    v.resize( static_cast<std::size_t>( n ) );
+    if( n )  is.read( reinterpret_cast<char*>( &v[0] ), v.size() * sizeof( v[0] ) );
+    return is.good();
+  }
+
+  //! remove dotlock left by dead process
+  /*!
+    @note dotlock is stale if PID written in it is not alive (on this host),
+      or it is older than lock_stale seconds (e.g. lock of MDA which writes
+      no PID). dotlock is removed only if it is still same file after check.
+    @retval true dotlock is removed (or already gone). retry now
+    @retval false dotlock is alive
+  */
+  bool break_stale_lock( const std::string& dotlock ) {
+#if defined(_WIN32)
+    struct _stat64  st, now;
+    if( ::_stat64( dotlock.c_str(), &st ) != 0 )  return true;
+    if( std::time( 0 ) - st.st_mtime < lock_stale )  return false;
+    if( ::_stat64( dotlock.c_str(), &now ) != 0 )  return true;
+#else
+    struct stat  st, now;
+    if( ::stat( dotlock.c_str(), &st ) != 0 )  return true;
+    bool  stale  =  ( lock_stale <= std::time( 0 ) - st.st_mtime );
+    if( !stale ) {
+      long  pid  =  0;
+      std::ifstream  ifs( dotlock.c_str() );
+      stale  =  ( ifs >> pid ) && 0 < pid && ::kill( static_cast<pid_t>( pid ), 0 ) != 0 && errno == ESRCH;
+    }
+    if( !stale )  return false;
+    if( ::stat( dotlock.c_str(), &now ) != 0 )  return true;
+    if( now.st_ino != st.st_ino )  return false;
+#endif // defined(_WIN32)
+    if( now.st_mtime != st.st_mtime )  return false;
+    return std::remove( dotlock.c_str() ) == 0;
+  }
+
+  //! lock of mbox file. (dotlock and fcntl lock)
+  /*!
+    @note delivery agents take "<mbox>.lock" and/or fcntl lock of mbox file
+      before append. both are taken here, so no message is appended while
+      mbox is rewritten. dotlock also serializes rewrites in this process.
+      PID is written to dotlock, and stale dotlock is removed. (see break_stale_lock)
+    @attention mbox is replaced by rename (see mbox_file::rewrite), and fcntl
+      lock belongs to old file. delivery agent which takes only fcntl lock may
+      wait on old file and append to it after rename, so the message is lost.
+      delivery agents must take dotlock. (e.g. procmail, or postfix local
+      with mailbox_delivery_lock = dotlock)
+  */
+  class mbox_lock : private boost::noncopyable {
+  public:
+    explicit mbox_lock( const std::string& path ) : dotlock_( path + lock_suffix ), dotlocked_( false ), fd_( -1 ) {
+      for( unsigned i = 0; i < lock_retries && !dotlocked_; ++i ) {
+#if defined(_WIN32)
+        int  fd  =  ::_open( dotlock_.c_str(), _O_CREAT | _O_EXCL | _O_WRONLY, _S_IREAD | _S_IWRITE );
+        if( 0 <= fd )  ::_close( fd );
+#else
+        int  fd  =  ::open( dotlock_.c_str(), O_CREAT | O_EXCL | O_WRONLY, 0644 );
+        if( 0 <= fd ) {
+          char  pid[32];
+          int   len  =  std::sprintf( pid, "%ld\n", static_cast<long>( ::getpid() ) );
+          if( ::write( fd, pid, len ) != len ) {}
+          ::close( fd );
+        }
+#endif // defined(_WIN32)
+        dotlocked_  =  ( 0 <= fd );
+        if( dotlocked_ || break_stale_lock( dotlock_ ) )  continue;
+        boost::this_thread::sleep( boost::posix_time::milliseconds( 100 ) );
+      }
+#if !defined(_WIN32)
+      if( !dotlocked_ )  return;
+      fd_  =  ::open( path.c_str(), O_RDWR );
+      if( fd_ < 0 )  return;
+      struct flock  fl;
+      std::memset( &fl, 0, sizeof( fl ) );
+      fl.l_type    =  F_WRLCK;
+      fl.l_whence  =  SEEK_SET;
+      if( ::fcntl( fd_, F_SETLKW, &fl ) != 0 ) {
+        ::close( fd_ );
+        fd_  =  -1;
+      }
+#endif // !defined(_WIN32)
+    }
+    ~mbox_lock() {
+#if !defined(_WIN32)
+      if( 0 <= fd_ )  ::close( fd_ );  // releases fcntl lock
+#endif // !defined(_WIN32)
+      if( dotlocked_ )  std::remove( dotlock_.c_str() );
+    }
+    //! inspect locks are taken
+    bool locked() const {
+#if defined(_WIN32)
+      return dotlocked_;
+#else
+      return dotlocked_ && 0 <= fd_;
+#endif // defined(_WIN32)
+    }
+  private:
+    std::string  dotlock_;
+    bool         dotlocked_;
+    int          fd_;
+  };
+
+  //! copy permission and owner of file to other file
+  /*!
+    @note owner can be changed by root only. failure is ignored.
+  */
+  void copy_mode( const std::string& from, const std::string& to ) {
+#if !defined(_WIN32)
+    struct stat  st;
+    if( ::stat( from.c_str(), &st ) != 0 )  return;
+    ::chmod( to.c_str(), st.st_mode & 07777 );
+    if( ::chown( to.c_str(), st.st_uid, st.st_gid ) != 0 ) {}
+#endif // !defined(_WIN32)
+  }
+}
+
+/*!
+  @defgroup pop3server_mbox POP3 mbox backend for server
+*/
+
+//! constructor. map file and load or build index.
+/*!
+  @attention throws boost::interprocess::interprocess_exception if file can not be mapped.
+*/
+mbox_file::mbox_file(
+  const std::string& path  //!< [in] mbox file path
+) :
+  path_( path ),
+  file_size_( file_size( path ) ),
+  mtime_( file_mtime( path ) ),
+  crlf_( true ),
+  mapping_(),
+  region_(),
+  entries_()
+{
+  if( file_size_ == 0 )  return;
+  boost::interprocess::file_mapping( path.c_str(), boost::interprocess::read_only ).swap( mapping_ );
+  boost::interprocess::mapped_region( mapping_, boost::interprocess::read_only ).swap( region_ );
+  file_size_  =  region_.get_size();
+  if( !load_cache() ) {
+    build();
+    save_cache();
+  }
+}
+
+//! mbox file path
+const std::string& mbox_file::path() const {
+  return path_;
+}
+
+//! number of messages
+std::size_t mbox_file::size() const {
+  return entries_.size();
+}
+
+//! get message index (0 origin)
+const mbox_entry& mbox_file::entry(
+  std::size_t index  //!< [in] message index (0 origin)
+) const {
+  BOOST_ASSERT( index < entries_.size() );
+  return entries_[ index ];
+}
+
+//! inspect file is changed after open
+bool mbox_file::stale() const {
+  return file_mtime( path_ ) != mtime_ || file_size( path_ ) != file_size_;
+}
+
+//! head of mapping
+const char* mbox_file::data() const {
+  return static_cast<const char*>( region_.get_address() );
+}
+
+//! build index by scanning mapping
+/*!
+  @note One pass over lines. memchr finds line ends, and only line heads
+    are inspected for separator, blank line, '.' and ">From ".
+  @ingroup pop3server_mbox
+*/
+void mbox_file::build() {
+  const char*  base  =  data();
+  const char*  end   =  base + file_size_;
+  const char*  p     =  base;
+  mbox_entry*  cur   =  0;
+  bool         in_header  =  false;
+  boost::uint64_t  bare_lf  =  0;
+  bool         prev_blank =  true;
+
+  entries_.clear();
+  crlf_  =  true;
+  while( p < end ) {
+    const char*  nl    =  static_cast<const char*>( std::memchr( p, '\n', end - p ) );
+    const char*  next  =  nl ? nl + 1 : end;
+    bool         blank =  ( next - p == 1 && *p == '\n' ) || ( next - p == 2 && *p == '\r' && p[1] == '\n' );
+    bool         bare  =  nl && ( nl == p || nl[-1] != '\r' );
+    if( bare )  crlf_  =  false;
+    if( prev_blank && is_from_line( p, next ) ) {
+      if( cur ) {
+        cur->length_  =  ( p - base ) - cur->offset_;
+        cur->octets_  =  bare_lf;
+      }
+      entries_.push_back( mbox_entry() );
+      cur  =  &entries_.back();
+      cur->from_        =  p - base;
+      cur->offset_      =  next - base;
+      cur->header_end_  =  0;
+      in_header  =  true;
+      bare_lf    =  0;
+    } else if( cur ) {
+      if( bare )  ++bare_lf;
+      if( in_header ) {
+        if( blank ) {
+          cur->header_end_  =  next - base;
+          in_header  =  false;
+        }
+      } else if( cur->body_lines_.size() < mbox_top_lines ) {
+        cur->body_lines_.push_back( static_cast<boost::uint32_t>( ( next - base ) - cur->header_end_ ) );
+      }
+      if( *p == '.' ) {
+        cur->dots_.push_back( p - base );
+      } else if( *p == '>' ) {
+        const char*  q  =  p;
+        while( q < next && *q == '>' )  ++q;
+        if( is_from_line( q, next ) )  cur->quoted_.push_back( p - base );
+      }
+    }
+    prev_blank  =  blank;
+    p  =  next;
+  }
+  if( cur ) {
+    cur->length_  =  file_size_ - cur->offset_;
+    cur->octets_  =  bare_lf;
+  }
+
+  // strip separator blank line. and fix up sizes.
+  std::map<boost::uint64_t, boost::uint64_t>  seen;
+  for( std::vector<mbox_entry>::iterator it = entries_.begin(); it != entries_.end(); ++it ) {
+    const char*  head  =  base + it->offset_;
+    const char*  tail  =  head + it->length_;
+    if( 2 <= tail - head && tail[-1] == '\n' && tail[-2] == '\n' ) {
+      --it->length_;
+      --it->octets_;  // bare LF
+    } else if( 4 <= tail - head && std::memcmp( tail - 4, "\r\n\r\n", 4 ) == 0 ) {
+      it->length_  -=  2;
+    }
+    boost::uint64_t  msg_end  =  it->offset_ + it->length_;
+    if( it->header_end_ == 0 || msg_end < it->header_end_ )  it->header_end_  =  msg_end;
+    while( !it->body_lines_.empty() && msg_end < it->header_end_ + it->body_lines_.back() ) {
+      it->body_lines_.pop_back();  // separator blank line
+    }
+    it->octets_  =  it->length_ + it->octets_ - it->quoted_.size();
+    it->uidl_    =  fnv1a( base + it->from_, base + it->header_end_ );
+    // same separator and header (e.g. duplicated delivery). number them.
+    boost::uint64_t  same  =  seen[ it->uidl_ ]++;
+    if( same ) {
+      const char*  n  =  reinterpret_cast<const char*>( &same );
+      it->uidl_  =  fnv1a( n, n + sizeof( same ), it->uidl_ );
+    }
+  }
+}
+
+//! load index cache
+/*!
+  @retval true cache is valid and loaded
+  @retval false no cache or cache is out of date
+*/
+bool mbox_file::load_cache() {
+  std::ifstream  ifs( ( path_ + cache_suffix ).c_str(), std::ios::binary );
+  boost::uint32_t  magic  =  0;
+  boost::uint64_t  size   =  0;
+  boost::int64_t   mtime  =  0;
+  boost::uint8_t   crlf   =  0;
+  boost::uint64_t  count  =  0;
+  if( !read_pod( ifs, magic ) || magic != cache_magic )  return false;
+  if( !read_pod( ifs, size ) || size != file_size_ )  return false;
+  if( !read_pod( ifs, mtime ) || mtime != mtime_ )  return false;
+  if( !read_pod( ifs, crlf ) || !read_pod( ifs, count ) )  return false;
+  std::vector<mbox_entry>  entries( static_cast<std::size_t>( count ) );
+  for( std::vector<mbox_entry>::iterator it = entries.begin(); it != entries.end(); ++it ) {
+    if( !read_pod( ifs, it->from_ ) || !read_pod( ifs, it->offset_ )
+      || !read_pod( ifs, it->length_ ) || !read_pod( ifs, it->header_end_ )
+      || !read_pod( ifs, it->octets_ ) || !read_pod( ifs, it->uidl_ )
+      || !read_positions( ifs, it->dots_ ) || !read_positions( ifs, it->quoted_ )
+      || !read_positions( ifs, it->body_lines_ ) ) {
+      return false;
+    }
+  }
+  crlf_  =  ( crlf != 0 );
+  entries_.swap( entries );
+  return true;
+}
+
+//! save index cache
+/*!
+  @note failure is ignored. (e.g. read only directory)
+*/
+void mbox_file::save_cache() const {
+  std::string  name  =  path_ + cache_suffix;
+  std::string  temp  =  name + ".tmp";
+  {
+    std::ofstream  ofs( temp.c_str(), std::ios::binary | std::ios::trunc );
+    if( !ofs )  return;
+    write_pod( ofs, cache_magic );
+    write_pod( ofs, file_size_ );
+    write_pod( ofs, mtime_ );
+    write_pod( ofs, static_cast<boost::uint8_t>( crlf_ ? 1 : 0 ) );
+    write_pod( ofs, static_cast<boost::uint64_t>( entries_.size() ) );
+    for( std::vector<mbox_entry>::const_iterator it = entries_.begin(); it != entries_.end(); ++it ) {
+      write_pod( ofs, it->from_ );
+      write_pod( ofs, it->offset_ );
+      write_pod( ofs, it->length_ );
+      write_pod( ofs, it->header_end_ );
+      write_pod( ofs, it->octets_ );
+      write_pod( ofs, it->uidl_ );
+      write_positions( ofs, it->dots_ );
+      write_positions( ofs, it->quoted_ );
+      write_positions( ofs, it->body_lines_ );
+    }
+    if( !ofs )  return;
+  }
+#if defined(_WIN32)
+  std::remove( name.c_str() );
+#endif // defined(_WIN32)
+  std::rename( temp.c_str(), name.c_str() );
+}
+
+//! append range with CRLF conversion
+/*!
+  @note if all lines end with CRLF, range is appended as one buffer. CR
+    before head of range is looked up in mapping, so CRLF split by chunk
+    boundary is not doubled.
+*/
+void mbox_file::append_range(
+  boost::uint64_t                           first,  //!< [in] start position
+  boost::uint64_t                           last,   //!< [in] end position
+  std::vector<boost::asio::const_buffer>&   out     //!< [out,ref] response buffers
+) const {
+  const char*  p    =  data() + first;
+  const char*  end  =  data() + last;
+  if( !crlf_ ) {
+    const char*  nl;
+    while( p < end && ( nl = static_cast<const char*>( std::memchr( p, '\n', end - p ) ) ) != 0 ) {
+      if( data() < nl && nl[-1] == '\r' ) {
+        out.push_back( boost::asio::const_buffer( p, nl + 1 - p ) );
+      } else {
+        if( p < nl )  out.push_back( boost::asio::const_buffer( p, nl - p ) );
+        out.push_back( boost::asio::const_buffer( crlf_str, 2 ) );
+      }
+      p  =  nl + 1;
+    }
+  }
+  if( p < end )  out.push_back( boost::asio::const_buffer( p, end - p ) );
+}
+
+//! build response buffers of one chunk of message. (RETR and TOP)
+/*!
+  @note buffers point into mapping, so mbox_file must outlive the write.
+    lines beginning with '.' are byte-stuffed, one '>' of ">From " lines is
+    removed, and termination octet is appended to last chunk.
+  @note chunk is at most limit octets of mbox file. (plus inserted CR and
+    '.') call again from returned position until it reaches last.
+  @ingroup pop3server_mbox
+  @retval end position of chunk
+*/
+boost::uint64_t mbox_file::segments(
+  std::size_t                               index,  //!< [in] message index (0 origin)
+  boost::uint64_t                           first,  //!< [in] start position of chunk
+  boost::uint64_t                           last,   //!< [in] end position of response
+  std::size_t                               limit,  //!< [in] max length of chunk in mbox file
+  std::vector<boost::asio::const_buffer>&   out     //!< [out,ref] response buffers
+) const {
+  const mbox_entry&  e  =  entry( index );
+  std::vector<boost::uint64_t>::const_iterator  d  =  std::lower_bound( e.dots_.begin(), e.dots_.end(), first );
+  std::vector<boost::uint64_t>::const_iterator  q  =  std::lower_bound( e.quoted_.begin(), e.quoted_.end(), first );
+  boost::uint64_t  stop  =  (std::min)( last, first + limit );
+  boost::uint64_t  pos   =  first;
+  while( pos < stop ) {
+    boost::uint64_t  dot_pos    =  ( d != e.dots_.end() )   ? *d : stop;
+    boost::uint64_t  quote_pos  =  ( q != e.quoted_.end() ) ? *q : stop;
+    boost::uint64_t  next       =  (std::min)( (std::min)( dot_pos, quote_pos ), stop );
+    append_range( pos, next, out );
+    // '.' or '>' at stop is handled by next chunk.
+    if( next == stop )  break;
+    if( next == dot_pos ) {
+      out.push_back( boost::asio::const_buffer( dot_str, 1 ) );
+      pos  =  next;
+      ++d;
+    } else {
+      pos  =  next + 1;
+      ++q;
+    }
+  }
+  if( stop < last )  return stop;
+  if( e.offset_ < last && data()[ last - 1 ] != '\n' ) {
+    out.push_back( boost::asio::const_buffer( crlf_str, 2 ) );
+  }
+  out.push_back( boost::asio::const_buffer( term_str, 3 ) );
+  return stop;
+}
+
+//! end position of header and first lines of body. (TOP)
+/*!
+  @note ends of first body lines are indexed. so TOP with small line count
+    is one range without touching body. only longer TOP scans lines.
+*/
+boost::uint64_t mbox_file::top_end(
+  std::size_t index,  //!< [in] message index (0 origin)
+  unsigned    lines   //!< [in] number of body lines
+) const {
+  const mbox_entry&  e    =  entry( index );
+  boost::uint64_t    msg_end  =  e.offset_ + e.length_;
+  if( lines == 0 )  return e.header_end_;
+  if( lines <= e.body_lines_.size() )  return e.header_end_ + e.body_lines_[ lines - 1 ];
+  if( e.body_lines_.size() < mbox_top_lines )  return msg_end;
+  const char*  p    =  data() + e.header_end_ + e.body_lines_.back();
+  const char*  end  =  data() + msg_end;
+  for( lines -= static_cast<unsigned>( e.body_lines_.size() ); lines && p < end; --lines ) {
+    const char*  nl  =  static_cast<const char*>( std::memchr( p, '\n', end - p ) );
+    p  =  nl ? nl + 1 : end;
+  }
+  return p - data();
+}
+
+//! write mbox without messages of uidls. (QUIT)
+/*!
+  @note new mbox is written to temporary file with permission and owner of
+    mbox, and renamed. sessions which still map old file keep reading old
+    contents. uidls not found in mbox (already removed) are ignored.
+  @attention caller holds mbox_lock. mbox_file must be opened under the lock.
+  @attention file is not rewritten in place, because other sessions map it.
+    so delivery agents must lock mbox by dotlock, not by fcntl only.
+    (see mbox_lock)
+  @ingroup pop3server_mbox
+  @retval true messages of uidls are removed (or not in mbox)
+  @retval false write or rename failed. mbox file is not changed
+*/
+bool mbox_file::rewrite(
+  const std::set<boost::uint64_t>& uidls  //!< [in] uidls of deleted messages
+) const {
+  std::size_t  removed  =  0;
+  std::string  temp  =  path_ + ".tmp";
+  {
+    std::ofstream  ofs( temp.c_str(), std::ios::binary | std::ios::trunc );
+    if( !ofs )  return false;
+    boost::uint64_t  pos  =  0;
+    for( std::size_t i = 0; i < entries_.size(); ++i ) {
+      boost::uint64_t  raw_end  =  ( i + 1 < entries_.size() ) ? entries_[ i + 1 ].from_ : file_size_;
+      if( uidls.count( entries_[i].uidl_ ) ) {
+        ofs.write( data() + pos, static_cast<std::streamsize>( entries_[i].from_ - pos ) );
+        pos  =  raw_end;
+        ++removed;
+      }
+    }
+    if( pos < file_size_ )  ofs.write( data() + pos, static_cast<std::streamsize>( file_size_ - pos ) );
+    ofs.close();
+    if( !ofs ) {
+      std::remove( temp.c_str() );
+      return false;
+    }
+  }
+  if( removed == 0 ) {
+    std::remove( temp.c_str() );
+    return true;
+  }
+  copy_mode( path_, temp );
+#if defined(_WIN32)
+  std::remove( path_.c_str() );
+#endif // defined(_WIN32)
+  if( std::rename( temp.c_str(), path_.c_str() ) != 0 ) {
+    std::remove( temp.c_str() );
+    return false;
+  }
+  return true;
+}
+
+//! open (or share) mbox file
+/*!
+  @note mbox_file is reopened if file is changed. registry is locked only to
+    look up and store mbox_file. mapping and index build run without lock,
+    so open of other mbox is not blocked by a large scan.
+  @attention blocks on file I/O. run on disk_io_executor.
+  @ingroup pop3server_mbox
+  @retval shared mbox file. null if file can not be mapped.
+*/
+boost::shared_ptr<mbox_file> mbox_registry::open(
+  const std::string& path  //!< [in] mbox file path
+) {
+  boost::shared_ptr<mbox_file>  file;
+  {
+    boost::mutex::scoped_lock  lock( mutex_ );
+    std::map< std::string, boost::weak_ptr<mbox_file> >::iterator  it  =  files_.find( path );
+    if( it != files_.end() )  file  =  it->second.lock();
+  }
+  if( file && !file->stale() )  return file;
+  try {
+    file.reset( new mbox_file( path ) );
+  } catch( boost::interprocess::interprocess_exception& ) {
+    return boost::shared_ptr<mbox_file>();
+  }
+  boost::mutex::scoped_lock  lock( mutex_ );
+  // drop entries of released mbox files.
+  std::map< std::string, boost::weak_ptr<mbox_file> >::iterator  it  =  files_.begin();
+  while( it != files_.end() ) {
+    if( it->second.expired() )  files_.erase( it++ );
+    else                        ++it;
+  }
+  files_[ path ]  =  file;
+  return file;
+}
+
+//! remove messages of uidls from mbox file
+/*!
+  @note messages are matched by uidl against current file, so deletions of
+    other sessions committed after snapshot are kept. mbox is locked while
+    it is read and rewritten. registry is locked only to look up and drop
+    mbox_file, so sessions of other mbox are not blocked by the rewrite.
+  @attention blocks on file I/O and lock. run on disk_io_executor.
+  @ingroup pop3server_mbox
+  @retval true deleted messages are removed
+  @retval false mbox can not be locked, mapped or rewritten. no message is removed
+*/
+bool mbox_registry::commit(
+  const std::string&                path,   //!< [in] mbox file path
+  const std::set<boost::uint64_t>&  uidls   //!< [in] uidls of deleted messages
+) {
+  if( uidls.empty() )  return true;
+  mbox_lock  file_lock( path );
+  if( !file_lock.locked() )  return false;
+  boost::shared_ptr<mbox_file>  file  =  open( path );
+  if( !file || !file->rewrite( uidls ) )  return false;
+  boost::mutex::scoped_lock  lock( mutex_ );
+  files_.erase( path );
+  return true;
+}
+
+}  // namespace pop3
+}  // namespace rfc
@@ -7,6 +7,7 @@
 //
 
 #include <pop3parser.hpp>
+#include <algorithm>
 #include <boost/regex.hpp>
 
 // RFC 1939
@@ -188,6 +189,52 @@ bool accept_contigous_mail_line(
   return true;
 }
 
+//! constructor
+pop3_arguments::pop3_arguments() :
+  head_(0),
+  size_(0)
+{
+}
+
+//! append argument
+void pop3_arguments::push_back(
+  const boost::any& arg  //!< [in] argument
+) {
+  if( capacity <= size_ )  return;
+  argv_[ ( head_ + size_ ) % capacity ]  =  arg;
+  ++size_;
+}
+
+//! first argument
+/*!
+  @retval first argument. empty value if queue is empty.
+*/
+boost::any& pop3_arguments::front() {
+  return argv_[ head_ ];
+}
+
+//! remove first argument
+/*!
+  @note value of argument is released here. (e.g. string argument)
+*/
+void pop3_arguments::pop_front() {
+  if( size_ == 0 )  return;
+  argv_[ head_ ]  =  boost::any();
+  head_  =  static_cast<unsigned char>( ( head_ + 1 ) % capacity );
+  --size_;
+}
+
+//! remove all arguments
+void pop3_arguments::clear() {
+  while( size_ != 0 )  pop_front();
+  head_  =  0;
+}
+
+//! inspect queue is empty
+bool pop3_arguments::empty() const {
+  return size_ == 0;
+}
+
 //! constructor
 pop3_state::pop3_state( 
   bool  apop_support  //!< [in] T: support APOP, F: not support APOP
@@ -196,14 +243,14 @@ pop3_state::pop3_state(
   in_transaction_(false),
   uname_active_(false),
   cmd_type_(pop3_detect_error),
-  result_(),
+  result_(""),
   argv_()
 {
 }
 
 //! clear parser result
 void pop3_state::clear_result() { 
-  result_.clear(); 
+  result_  =  "";
   argv_.clear();
 }
 
@@ -250,6 +297,31 @@ pop3_command_symbols::pop3_command_symbols() {
   ;
 }
 
+//! constructor
+pop3_command_parser::pop3_command_parser() {
+  std::fill( grammars_, grammars_ + grammar_count, static_cast<pop3_command_grammar<char const*>*>( 0 ) );
+}
+
+//! destructor
+pop3_command_parser::~pop3_command_parser() {
+  for( std::size_t i = 0; i < grammar_count; ++i )  delete grammars_[i];
+}
+
+//! parse command line. results are set to state.
+/*!
+  @retval true command line is parsed. (command or error is set to state)
+*/
+bool pop3_command_parser::parse(
+  const std::string&  command,  //!< [in] command line (include CRLF)
+  pop3_state&         state     //!< [in,out] state of session
+) {
+  std::size_t  key  =  ( state.apop_support_ ? 4 : 0 ) | ( state.in_transaction_ ? 2 : 0 ) | ( state.uname_active_ ? 1 : 0 );
+  pop3_command_grammar<char const*>*&  grammar  =  grammars_[ key ];
+  if( grammar )  grammar->bind( state );
+  else           grammar  =  new pop3_command_grammar<char const*>( state );
+  return boost::spirit::classic::parse( command.c_str(), *grammar ).full;
+}
+
 } // namespace pop3
 }  // namespace rfc
 